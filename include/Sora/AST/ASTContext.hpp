@@ -55,8 +55,6 @@ class alignas(ASTContextAlignement) ASTContext final {
 
   llvm::BumpPtrAllocator &getArena(ArenaKind kind = ArenaKind::Permanent);
 
-  void buildBuiltinTypesLookupMap();
-
 public:
   /// Members for ASTContext.cpp
   Impl &getImpl();
@@ -75,9 +73,7 @@ public:
   /// \returns a pointer to the allocated memory (aligned to \p align) or
   /// nullptr if \p size == 0
   void *allocate(size_t size, size_t align,
-                 ArenaKind allocator = ArenaKind::Permanent) {
-    return size ? getArena(allocator).Allocate(size, align) : nullptr;
-  }
+                 ArenaKind allocator = ArenaKind::Permanent);
 
   /// Allocates enough memory for an object \p Ty.
   /// This simply calls allocate using sizeof/alignof Ty.
@@ -89,9 +85,23 @@ public:
   }
 
   /// \returns true if the ArenaKind::TypeVariableEnvironment allocator is
-  /// active. It is only active if a TypeVariableEnvironment is alive.
+  /// active. It is only active if a TypeVariableEnvironment is alive on the
+  /// current thread.
   bool hasTypeVariableEnvironmentArena() const;
 
+  /// Enables or disables thread-safe mode.
+  ///
+  /// In thread-safe mode, memory can be allocated, types can be created and
+  /// identifiers can be interned from multiple threads at once. Each thread
+  /// can also have its own TypeVariableEnvironment.
+  ///
+  /// This adds some locking overhead, so it should only be enabled while the
+  /// ASTContext is actually being used by multiple threads.
+  void setThreadSafe(bool value = true);
+
+  /// \returns true if thread-safe mode is enabled.
+  bool isThreadSafe() const;
+
   /// Frees (deallocates) all UnresolvedExprs allocated within this ASTContext.
   void freeUnresolvedExprs();
 
@@ -101,6 +111,11 @@ public:
   /// \returns the memory used (in bytes) by \p arena.
   size_t getMemoryUsed(ArenaKind arena) const;
 
+  /// Prints a detailed breakdown of the memory used by this ASTContext to
+  /// \p out: the identifier table, the slabs of each arena, and the number and
+  /// size of the uniqued types of each kind.
+  void printMemoryUsage(raw_ostream &out) const;
+
   /// Adds a cleanup function that'll be run when the ASTContext's memory (&
   /// Permanent Allocator) is freed.
   void addCleanup(std::function<void()> cleanup);
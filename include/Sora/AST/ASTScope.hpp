@@ -64,6 +64,16 @@ class alignas(ASTScopeAlignement) ASTScope {
   /// Whether this scope is implicit
   bool implicit : 2;
 
+  /// The SourceRange of this scope, cached when the scope is created so
+  /// lookups don't need to dispatch on the kind of scope every time.
+  /// This is always invalid for SourceFileScopes, as their range grows when
+  /// members are added to the SourceFile.
+  SourceRange cachedRange;
+
+  /// \returns the SourceRange of this scope, computed using the derived
+  /// class' getSourceRange or getBegLoc/getEndLoc methods.
+  SourceRange computeSourceRange() const;
+
   /// \returns true if this ASTScope needs cleanup
   bool needsCleanup() const {
     const char *beg = reinterpret_cast<const char *>(this);
@@ -93,6 +103,10 @@ protected:
   void *operator new(size_t size, ASTContext &ctxt,
                      unsigned align = alignof(ASTScope));
 
+  /// Computes the SourceRange of this scope and caches it.
+  /// This must be called once the scope is fully constructed.
+  void cacheSourceRange() { cachedRange = computeSourceRange(); }
+
 public:
   /// \returns the kind of scope this is
   ASTScopeKind getKind() const { return parentAndKind.getInt(); }
@@ -122,6 +136,9 @@ public:
   /// \returns the innermost scope around \p loc, or this if no this is the
   /// innermost scope.
   /// \p loc must be within this scope's SourceRange.
+  ///
+  /// If this is a SourceFileScope with an interval index, the index is used
+  /// instead of walking the tree.
   ASTScope *findInnermostScope(SourceLoc loc);
 
   /// \returns true if this ASTScope is implicit
@@ -187,16 +204,57 @@ private:
 
 /// Represents the scope of a SourceFile
 class SourceFileScope final : public ASTScope {
+public:
+  /// An entry of the interval index: \p scope is the innermost scope for
+  /// every SourceLoc from \p begin up to the begin of the next entry.
+  struct IntervalIndexEntry {
+    SourceLoc begin;
+    ASTScope *scope;
+  };
+
+private:
   SourceFileScope(SourceFile &file)
       : ASTScope(ASTScopeKind::SourceFile, nullptr), sourceFile(file) {}
 
   SourceFile &sourceFile;
 
+  /// The flattened scope map, sorted by SourceLoc.
+  /// This is allocated in the ASTContext and is empty until
+  /// buildIntervalIndex() is called.
+  ArrayRef<IntervalIndexEntry> intervalIndex;
+  /// Whether buildIntervalIndex() has been called.
+  bool indexBuilt = false;
+
 public:
   static SourceFileScope *create(SourceFile &sf);
 
   SourceFile &getSourceFile() const { return sourceFile; }
 
+  /// Fully expands the scope map and flattens it into an interval index that
+  /// findInnermostScope can binary search without walking the tree.
+  /// This does nothing if the index has already been built.
+  ///
+  /// Once the index is built, the scope map is never modified again, so
+  /// findInnermostScope can safely be called from multiple threads.
+  ///
+  /// Note that the index isn't updated when members are added to the
+  /// SourceFile, so this should only be called once the SourceFile has been
+  /// fully parsed.
+  void buildIntervalIndex();
+
+  /// \returns true if buildIntervalIndex() has been called.
+  bool hasIntervalIndex() const { return indexBuilt; }
+
+  /// \returns the interval index, which is empty until buildIntervalIndex()
+  /// is called.
+  ArrayRef<IntervalIndexEntry> getIntervalIndex() const {
+    return intervalIndex;
+  }
+
+  /// \returns the innermost scope around \p loc using the interval index.
+  /// hasIntervalIndex() must be true.
+  ASTScope *findInnermostScopeInIndex(SourceLoc loc) const;
+
   SourceLoc getBegLoc() const;
   SourceLoc getEndLoc() const;
 
@@ -355,9 +355,25 @@ class IntegerLiteralExpr final : public AnyLiteralExpr {
   /// destructible.
   StringRef strValue;
 
+  /// The IntegerType for which the value has been computed, or nullptr if it
+  /// hasn't been computed yet.
+  mutable TypeBase *valueType = nullptr;
+  /// The bitwidth of the cached value.
+  mutable unsigned valueBitWidth = 0;
+  /// Whether the cached value had to be truncated.
+  mutable bool valueOverflows = false;
+  /// The words of the cached value. Values that fit in a single word are
+  /// stored inline, larger ones are stored in the ASTContext.
+  mutable union {
+    uint64_t inlineWord;
+    const uint64_t *words;
+  } value;
+
 public:
   IntegerLiteralExpr(StringRef strValue, SourceLoc loc)
-      : AnyLiteralExpr(ExprKind::IntegerLiteral, loc), strValue(strValue) {}
+      : AnyLiteralExpr(ExprKind::IntegerLiteral, loc), strValue(strValue) {
+    value.inlineWord = 0;
+  }
 
   /// \returns the string version of the literal as written by the user
   StringRef getString() const { return strValue; }
@@ -370,7 +386,8 @@ public:
   /// e.g. if this has a i32 type, this returns a 32 bit integer, if it has a
   /// u64 type, this returns a 64 bits integer, etc.
   ///
-  /// Note that this is relatively expensive, and the result is not cached.
+  /// The literal is only parsed the first time this is called for a given
+  /// type, and the result is cached in the expression.
   APInt getValue(bool *overflows = nullptr) const;
 
   static bool classof(const Expr *expr) {
@@ -380,10 +397,16 @@ public:
 
 /// Represents a floating-point literal (3.14, 42.42, etc.)
 class FloatLiteralExpr final : public AnyLiteralExpr {
-  /// Store the literal as a StringRef because APInt isn't trivially
+  /// Store the literal as a StringRef because APFloat isn't trivially
   /// destructible.
   StringRef strValue;
 
+  /// The FloatType for which the value has been computed, or nullptr if it
+  /// hasn't been computed yet.
+  mutable TypeBase *valueType = nullptr;
+  /// The bit pattern of the cached value.
+  mutable uint64_t valueBits = 0;
+
 public:
   FloatLiteralExpr(StringRef strValue, SourceLoc loc)
       : AnyLiteralExpr(ExprKind::FloatLiteral, loc), strValue(strValue) {}
@@ -396,8 +419,8 @@ public:
   /// e.g. if this has a f32 type, this returns a single precision float, if
   /// this has a f64 type, it returns a double-precision float.
   ///
-  /// This is relatively expensive (parsing isn't cached), so don't abuse it
-  /// where performance matters.
+  /// The literal is only parsed the first time this is called for a given
+  /// type, and the result is cached in the expression.
   APFloat getValue() const;
 
   static bool classof(const Expr *expr) {
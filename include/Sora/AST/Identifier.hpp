@@ -9,21 +9,52 @@
 
 #include "Sora/Common/LLVM.hpp"
 #include "llvm/ADT/DenseMapInfo.h"
+#include <cassert>
 #include <string>
 
 namespace sora {
 /// Represents a unique'd language identifier.
+///
+/// Identifiers are interned in the ASTContext's permanent arena, where their
+/// characters are preceded by a Header.
 class Identifier {
+public:
+  /// The header of an interned identifier, which is allocated right before its
+  /// (null-terminated) characters.
+  struct Header {
+    /// The hash of the identifier's string, which doesn't depend on where it
+    /// has been allocated.
+    unsigned hash;
+    /// The length of the identifier's string, in bytes.
+    unsigned length;
+
+    /// \returns the characters that follow this header.
+    char *getChars() { return reinterpret_cast<char *>(this + 1); }
+  };
+
+private:
   const char *value = nullptr;
 
   friend class ASTContext;
   friend struct llvm::DenseMapInfo<sora::Identifier>;
   Identifier(const char *value) : value(value) {}
 
+  /// \returns the header of this identifier, which must be valid.
+  const Header *getHeader() const {
+    assert(isValid() && "invalid identifier has no header");
+    return reinterpret_cast<const Header *>(value) - 1;
+  }
+
 public:
   /// Create a null identifier
   Identifier() = default;
 
+  /// \returns the hash of this identifier, or 0 if it's invalid.
+  /// Unlike the address of the identifier, this is the same for every
+  /// ASTContext and every execution, so it can be used to iterate over maps
+  /// keyed by identifiers in a deterministic order.
+  unsigned getHash() const { return isValid() ? getHeader()->hash : 0; }
+
   /// \returns this identifier as a string
   StringRef str() const;
 
@@ -68,7 +99,7 @@ template <> struct DenseMapInfo<sora::Identifier> {
   }
 
   static unsigned getHashValue(const sora::Identifier &ident) {
-    return DenseMapInfo<const char *>::getHashValue(ident.c_str());
+    return ident.getHash();
   }
 
   static bool isEqual(const sora::Identifier &lhs,
@@ -13,7 +13,9 @@
 #include "Sora/Common/LLVM.hpp"
 #include "Sora/Common/SourceManager.hpp"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/TinyPtrVector.h"
 
 namespace sora {
 class ASTWalker;
@@ -24,6 +26,12 @@ class SourceFileScope;
 /// Represents a source file.
 class alignas(SourceFileAlignement) SourceFile final : public DeclContext {
   SmallVector<ValueDecl *, 4> members;
+  /// Maps identifiers to the members that have that identifier, in the order
+  /// in which they were added. This is lazily built by lookup().
+  mutable llvm::DenseMap<Identifier, llvm::TinyPtrVector<ValueDecl *>>
+      lookupTable;
+  /// Whether lookupTable has been built.
+  mutable bool hasLookupTable = false;
   SourceFileScope *fileScope = nullptr;
   BufferID bufferID;
 
@@ -48,7 +56,14 @@ public:
   /// \returns the members of this source file
   ArrayRef<ValueDecl *> getMembers() const { return members; }
   /// Adds a member to this source file
-  void addMember(ValueDecl *decl) { return members.push_back(decl); }
+  void addMember(ValueDecl *decl);
+  /// \returns the members of this source file whose identifier is \p ident,
+  /// in the order in which they were added.
+  ArrayRef<ValueDecl *> lookup(Identifier ident) const;
+  /// Builds the table used by lookup() if it hasn't been built yet.
+  /// lookup() does this lazily, so this only needs to be called before
+  /// lookups are performed from multiple threads at once.
+  void buildLookupTable() const;
   /// \returns the BufferID of this SourceFile
   BufferID getBufferID() const { return bufferID; }
   /// \returns the buffer identifier of this Sourcefile
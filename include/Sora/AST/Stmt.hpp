@@ -55,9 +55,10 @@ protected:
     );
 
     // BlockStmt 
-    SORA_INLINE_BITFIELD_FULL(BlockStmt, Stmt, 32, 
+    SORA_INLINE_BITFIELD_FULL(BlockStmt, Stmt, 32+1, 
       : NumPadBits, 
-      numElements : 32
+      numElements : 32,
+      hasFuncDecl : 1
     );
 
     // clang-format on
@@ -215,6 +216,9 @@ class BlockStmt final
   BlockStmt(SourceLoc lCurlyLoc, ArrayRef<BlockStmtElement> nodes,
             SourceLoc rCurlyLoc);
 
+  /// \returns true if \p elt is a FuncDecl
+  static bool isFuncDecl(BlockStmtElement elt);
+
 public:
   static BlockStmt *create(ASTContext &ctxt, SourceLoc lCurlyLoc,
                            ArrayRef<BlockStmtElement> elts,
@@ -237,7 +241,13 @@ public:
   }
 
   BlockStmtElement getElement(size_t n) const { return getElements()[n]; }
-  void setElement(size_t n, BlockStmtElement elt) { getElements()[n] = elt; }
+  void setElement(size_t n, BlockStmtElement elt);
+
+  /// \returns true if this block may contain a FuncDecl. This is used by name
+  /// lookup to skip blocks that don't declare any function.
+  /// Note that this may return true when the block no longer contains a
+  /// FuncDecl, but it never returns false when it does.
+  bool hasFuncDecl() const { return bits.BlockStmt.hasFuncDecl; }
 
   /// \returns the SourceLoc of the first token of the statement
   SourceLoc getBegLoc() const { return lCurlyLoc; }
@@ -84,6 +84,24 @@ public:
   /// \returns whether \p typeVar is bound.
   bool isBound(TypeVariableType *typeVar) const;
 
+  /// \returns the representative of \p typeVar's equivalence class.
+  ///
+  /// Binding a type variable to another type variable merges their
+  /// equivalence classes. The representative of a class is the only type
+  /// variable of the class that isn't bound to another type variable: it's
+  /// either unbound, or bound to the type that every type variable of the
+  /// class is bound to.
+  ///
+  /// This compresses the path from \p typeVar to the representative, so
+  /// repeated calls are nearly constant time.
+  TypeVariableType *getRepresentative(TypeVariableType *typeVar) const;
+
+  /// \returns the rank of \p typeVar, which is an upper bound on the height of
+  /// the tree formed by its equivalence class if it's a representative.
+  /// When merging two equivalence classes, the representative with the lowest
+  /// rank should be bound to the other one to keep the trees shallow.
+  unsigned getRank(TypeVariableType *typeVar) const;
+
   /// Simplifies \p type, replacing all type variables with their
   /// binding/default type, or an error type if no default type exists for this
   /// TV.
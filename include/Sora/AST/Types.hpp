@@ -27,8 +27,10 @@
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/PointerUnion.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/TrailingObjects.h"
+#include <atomic>
 
 namespace llvm {
 struct fltSemantics;
@@ -165,11 +167,22 @@ protected:
   static_assert(sizeof(Bits) == 8, "Bits is too large!");
 
 private:
+  using CtxtOrCanType = llvm::PointerUnion<ASTContext *, TypeBase *>;
+
   /// This union always contains the ASTContext for canonical types.
   /// For non-canonical types, it contains the ASTContext if the canonical type
   /// hasn't been calculated yet, else it contains a pointer to the canonical
   /// type.
-  mutable llvm::PointerUnion<ASTContext *, TypeBase *> ctxtOrCanType;
+  ///
+  /// It is stored as an opaque value so it can be accessed atomically: Sema
+  /// may compute the canonical type of a shared type from several threads.
+  mutable std::atomic<void *> ctxtOrCanType;
+
+  /// \returns the current value of ctxtOrCanType
+  CtxtOrCanType getCtxtOrCanType() const {
+    return CtxtOrCanType::getFromOpaqueValue(
+        ctxtOrCanType.load(std::memory_order_acquire));
+  }
 
 protected:
   // Children should be able to use placement new, as it is needed for children
@@ -191,7 +204,7 @@ protected:
   /// \param canonical whether this type is canonical
   TypeBase(TypeKind kind, TypeProperties properties, ASTContext &ctxt,
            bool canonical)
-      : ctxtOrCanType(&ctxt) {
+      : ctxtOrCanType(CtxtOrCanType(&ctxt).getOpaqueValue()) {
     bits.TypeBase.kind = (uint64_t)kind;
     bits.TypeBase.isCanonical = canonical;
     bits.TypeBase.typePropertiesValue = properties.value;
@@ -213,11 +226,12 @@ public:
 
   /// \returns the ASTContext in which this type is allocated
   ASTContext &getASTContext() const {
-    if (ASTContext *ctxt = ctxtOrCanType.dyn_cast<ASTContext *>()) {
+    CtxtOrCanType value = getCtxtOrCanType();
+    if (ASTContext *ctxt = value.dyn_cast<ASTContext *>()) {
       assert(ctxt && "ASTContext pointer is null!");
       return *ctxt;
     }
-    return ctxtOrCanType.get<TypeBase *>()->getASTContext();
+    return value.get<TypeBase *>()->getASTContext();
   }
 
   /// \returns the canonical version of this type
@@ -231,10 +245,20 @@ public:
   /// The rebuilder is called in post-order: the leaves of the type tree are
   /// visited first.
   ///
+  /// The result is memoized, so the rebuilder is called at most once per
+  /// unique type, even if it appears multiple times in the tree. The rebuilder
+  /// must thus always give the same result for a given type.
+  ///
   /// Also, note that this will not change this type - it'll create a new one.
   ///
+  /// \param onlyIf if not empty, only the types that have at least one of
+  /// these properties are visited. The rebuilder must return nullptr for
+  /// every other type. This allows the rebuilder to skip entire subtrees, and
+  /// even the whole type.
+  ///
   /// \returns the rebuilt type, or this type if nothing was rebuilt.
-  Type rebuildType(std::function<Type(Type)> rebuilder);
+  Type rebuildType(llvm::function_ref<Type(Type)> rebuilder,
+                   TypeProperties onlyIf = TypeProperties());
 
   /// Rebuilds this type without LValues.
   Type rebuildTypeWithoutLValues();
@@ -664,6 +688,9 @@ enum class TypeVariableKind : uint8_t {
 ///
 /// Represents a type variable existing within a constraint system.
 ///
+/// Type variables that are bound to each other form an equivalence class, see
+/// TypeVariableEnvironment::getRepresentative.
+///
 /// Used by Sema, this type is never unique and is always allocated
 /// in the ASTContext's TypeVariableEnvironment arena.
 /// Note that types containing TypeVariables are also allocated in the
@@ -674,6 +701,13 @@ class TypeVariableType final : public TypeBase {
   friend TypeVariableEnvironment;
 
   Type binding;
+  /// The next type variable on the path to the representative of this type
+  /// variable's equivalence class, or null if this is the representative.
+  /// This is set when this type variable is bound to another type variable.
+  mutable TypeVariableType *parent = nullptr;
+  /// For representatives, an upper bound on the height of the tree formed by
+  /// their equivalence class.
+  unsigned rank = 0;
 
   void setTypeVariableKind(TypeVariableKind kind) {
     bits.TypeVariableType.tvKind = (unsigned)kind;
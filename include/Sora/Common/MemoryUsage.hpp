@@ -0,0 +1,37 @@
+//===--- MemoryUsage.hpp - Memory Usage Counters ----------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "Sora/Common/LLVM.hpp"
+#include "llvm/Support/NativeFormatting.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstddef>
+
+namespace sora {
+/// The number of objects of some kind, and the memory they use.
+struct MemoryUsage {
+  size_t count = 0;
+  size_t bytes = 0;
+
+  /// Counts an object of \p size bytes.
+  void add(size_t size) {
+    ++count;
+    bytes += size;
+  }
+
+  /// Prints "<name>: <count>, <bytes> bytes" on its own line, indented by
+  /// \p indent spaces. Nothing is printed if no object was counted.
+  void print(raw_ostream &out, StringRef name, unsigned indent) const {
+    if (!count)
+      return;
+    out.indent(indent) << name << ": " << count << ", ";
+    llvm::write_integer(out, bytes, 0, llvm::IntegerStyle::Number);
+    out << " bytes\n";
+  }
+};
+} // namespace sora
@@ -11,7 +11,9 @@
 
 #include "Sora/Common/LLVM.hpp"
 #include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/SMLoc.h"
+#include <cstdint>
 
 namespace sora {
 class SourceManager;
@@ -19,16 +21,22 @@ class SourceManager;
 /// Represents the location of a byte in a source file owned by a SourceManager.
 /// Generally, the byte will be the first byte of a token.
 ///
-/// This is simply a wrapper around a llvm::SMLoc (which is essentially a
-/// wrapper const char*)
+/// Every buffer given to a SourceManager is assigned a contiguous range of
+/// offsets in a process-wide address space, and a SourceLoc is simply a 32 bit
+/// offset into that address space (0 is the invalid SourceLoc). This keeps
+/// SourceLocs, and thus AST nodes, small. The pointer to the byte can be
+/// retrieved using getPointer() as long as the SourceManager is alive. Once
+/// it's destroyed, the offsets of its buffers can be reused.
 ///
 /// Comparison operators (>, >=, <=, <, ==, !=) can be used to compare the
-/// underyling pointers of 2 SourceLocs. Iff the SourceLocs come from the same
+/// underyling offsets of 2 SourceLocs. Iff the SourceLocs come from the same
 /// buffer, this can be used to determine if a SourceLoc is before another one.
 class SourceLoc {
   friend class SourceManager;
 
-  llvm::SMLoc value;
+  uint32_t value = 0;
+
+  explicit SourceLoc(uint32_t value) : value(value) {}
 
   bool isComparisonLegal(SourceLoc rhs) const {
     // They must be both valid or invalid.
@@ -37,17 +45,18 @@ class SourceLoc {
 
 public:
   SourceLoc() = default;
-  explicit SourceLoc(llvm::SMLoc value) : value(value) {}
 
   /// \returns a copy of this SourceLoc advanced by \p offset bytes.
   /// This SourceLoc must be valid.
   SourceLoc getAdvancedLoc(unsigned offset) const {
     assert(isValid() && "not valid!");
-    return SourceLoc(llvm::SMLoc::getFromPointer(value.getPointer() + offset));
+    return SourceLoc(value + offset);
   }
 
-  /// \returns the pointer value of this SourceLoc.
-  const char *getPointer() const { return value.getPointer(); }
+  /// \returns the pointer value of this SourceLoc, or nullptr if this
+  /// SourceLoc is invalid.
+  /// The SourceManager that owns the buffer must still be alive.
+  const char *getPointer() const;
 
   /// \returns a copy of this SourceLoc advanced by \p offset bytes, or
   /// SourceLoc() if this SourceLoc is not valid.
@@ -55,18 +64,25 @@ public:
     return isValid() ? getAdvancedLoc(numBytes) : SourceLoc();
   }
 
-  /// \returns the underlying llvm::SMLoc
-  llvm::SMLoc getSMLoc() const { return value; }
-
-  /// Creates a SourceLoc from a pointer \p ptr
-  /// NOTE: To be used wisely. Don't mix this with SourceLocs into files managed
-  /// by the SourceManager.
-  static SourceLoc fromPointer(const char *ptr) {
-    return SourceLoc(llvm::SMLoc::getFromPointer(ptr));
+  /// \returns this SourceLoc as a llvm::SMLoc
+  llvm::SMLoc getSMLoc() const {
+    return llvm::SMLoc::getFromPointer(getPointer());
   }
 
+  /// Creates a SourceLoc from a pointer \p ptr inside (or past-the-end of) a
+  /// buffer owned by a SourceManager.
+  /// \returns the SourceLoc, or SourceLoc() if \p ptr is null or if no buffer
+  /// contains it.
+  static SourceLoc fromPointer(const char *ptr);
+
+  /// \returns the raw offset of this SourceLoc
+  uint32_t getRawValue() const { return value; }
+
+  /// \returns a SourceLoc from a raw offset returned by getRawValue()
+  static SourceLoc getFromRawValue(uint32_t value) { return SourceLoc(value); }
+
   /// \returns true if this SourceLoc is valid
-  bool isValid() const { return value.isValid(); }
+  bool isValid() const { return value != 0; }
   /// \returns true if this SourceLoc is invalid
   bool isInvalid() const { return !isValid(); }
   /// \returns true if this SourceLoc is valid
@@ -78,22 +94,22 @@ public:
 
   bool operator<(const SourceLoc other) const {
     assert(isComparisonLegal(other) && "illegal comparison");
-    return value.getPointer() < other.value.getPointer();
+    return value < other.value;
   }
 
   bool operator<=(const SourceLoc other) const {
     assert(isComparisonLegal(other) && "illegal comparison");
-    return value.getPointer() <= other.value.getPointer();
+    return value <= other.value;
   }
 
   bool operator>(const SourceLoc other) const {
     assert(isComparisonLegal(other) && "illegal comparison");
-    return value.getPointer() > other.value.getPointer();
+    return value > other.value;
   }
 
   bool operator>=(const SourceLoc other) const {
     assert(isComparisonLegal(other) && "illegal comparison");
-    return value.getPointer() >= other.value.getPointer();
+    return value >= other.value;
   }
 
   bool operator==(const SourceLoc other) const {
@@ -129,9 +145,7 @@ public:
   SourceRange(SourceLoc begin, SourceLoc end) : begin(begin), end(end) {
     assert(begin.isValid() == end.isValid() &&
            "begin & end should both be valid or invalid");
-    assert(
-        (begin.isValid() ? (begin.getPointer() <= end.getPointer()) : true) &&
-        "end > begin!");
+    assert((begin.isValid() ? (begin <= end) : true) && "end > begin!");
   }
 
   /// \returns true if this SourceRange is valid
@@ -157,13 +171,15 @@ public:
 /// Represents a half-open range of characters in the source.
 class CharSourceRange {
   SourceLoc begin;
-  size_t byteLength = 0;
+  uint32_t byteLength = 0;
 
 public:
   CharSourceRange() = default;
 
   explicit CharSourceRange(SourceLoc begin, size_t byteLength = 0)
-      : begin(begin), byteLength(byteLength) {}
+      : begin(begin), byteLength(byteLength) {
+    assert(byteLength <= UINT32_MAX && "range is too large");
+  }
 
   /// Creates a CharSourceRange from 2 SourceLocs by calculating the distance
   /// between them in bytes.
@@ -227,17 +243,17 @@ public:
 namespace llvm {
 template <> struct DenseMapInfo<sora::SourceLoc> {
   static sora::SourceLoc getEmptyKey() {
-    return sora::SourceLoc::fromPointer(
-        DenseMapInfo<const char *>::getEmptyKey());
+    return sora::SourceLoc::getFromRawValue(
+        DenseMapInfo<uint32_t>::getEmptyKey());
   }
 
   static sora::SourceLoc getTombstoneKey() {
-    return sora::SourceLoc::fromPointer(
-        DenseMapInfo<const char *>::getTombstoneKey());
+    return sora::SourceLoc::getFromRawValue(
+        DenseMapInfo<uint32_t>::getTombstoneKey());
   }
 
   static unsigned getHashValue(const sora::SourceLoc &loc) {
-    return DenseMapInfo<const char *>::getHashValue(loc.getPointer());
+    return DenseMapInfo<uint32_t>::getHashValue(loc.getRawValue());
   }
 
   static bool isEqual(const sora::SourceLoc &lhs, const sora::SourceLoc &rhs) {
@@ -247,18 +263,16 @@ template <> struct DenseMapInfo<sora::SourceLoc> {
 
 template <> struct DenseMapInfo<sora::SourceRange> {
   static sora::SourceRange getEmptyKey() {
-    return sora::SourceLoc::fromPointer(
-        DenseMapInfo<const char *>::getEmptyKey());
+    return DenseMapInfo<sora::SourceLoc>::getEmptyKey();
   }
 
   static sora::SourceRange getTombstoneKey() {
-    return sora::SourceLoc::fromPointer(
-        DenseMapInfo<const char *>::getTombstoneKey());
+    return DenseMapInfo<sora::SourceLoc>::getTombstoneKey();
   }
 
   static unsigned getHashValue(const sora::SourceRange &loc) {
-    auto beg = DenseMapInfo<const char *>::getHashValue(loc.begin.getPointer());
-    auto end = DenseMapInfo<const char *>::getHashValue(loc.end.getPointer());
+    auto beg = DenseMapInfo<sora::SourceLoc>::getHashValue(loc.begin);
+    auto end = DenseMapInfo<sora::SourceLoc>::getHashValue(loc.end);
     return hash_combine(beg, end);
   }
 
@@ -9,8 +9,10 @@
 
 #include "Sora/Common/SourceLoc.hpp"
 #include "llvm/Support/SourceMgr.h"
+#include <atomic>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace sora {
 /// Wrapper around an unsigned integer, used to represent a Buffer ID.
@@ -41,6 +43,7 @@ public:
 class SourceManager {
 public:
   SourceManager() = default;
+  ~SourceManager();
 
   // The SourceManager is non-copyable.
   SourceManager(const SourceManager &) = delete;
@@ -56,39 +59,52 @@ public:
 
   /// Gives a buffer to this SourceManager, returning a BufferID for that
   /// buffer and taking ownership of it.
+  ///
+  /// The buffer is assigned a range of SourceLocs, which is released when the
+  /// SourceManager is destroyed.
   BufferID giveBuffer(std::unique_ptr<llvm::MemoryBuffer> buffer);
 
+  /// The default value of the \p mmapThreshold parameter of loadFile.
+  static constexpr uint64_t defaultMMapThreshold = 16 * 1024;
+
+  /// Loads the file at \p path and gives it to this SourceManager.
+  ///
+  /// Files of at least \p mmapThreshold bytes are memory-mapped instead of
+  /// being copied into memory. Like every other buffer, mapped buffers are
+  /// null-terminated: the null terminator is the zero-filled tail of the last
+  /// page of the mapping. Files whose size is a multiple of the page size
+  /// don't have such a tail, so they are always copied into memory.
+  ///
+  /// \returns the BufferID of the file, or a null BufferID if the file
+  /// couldn't be loaded.
+  BufferID loadFile(StringRef path,
+                    uint64_t mmapThreshold = defaultMMapThreshold);
+
   /// \returns the string of the buffer with id \p id
   StringRef getBufferStr(BufferID id) const;
 
   /// \returns the BufferID of the buffer that contains \p loc
-  BufferID findBufferContainingLoc(SourceLoc loc) const {
-    return llvmSourceMgr.FindBufferContainingLoc(loc.value);
-  }
+  BufferID findBufferContainingLoc(SourceLoc loc) const;
 
   /// \returns the line and column represented by \p loc.
   /// If \p id is valid, \p loc must come from that source buffer.
   /// If \p id is invalid, the SourceManager will search for the correct source
   /// buffer.
   std::pair<unsigned, unsigned>
-  getLineAndColumn(SourceLoc loc, BufferID id = BufferID()) const {
-    assert(loc && "loc cannot be invalid");
-    return llvmSourceMgr.getLineAndColumn(loc.value, id.value);
-  }
+  getLineAndColumn(SourceLoc loc, BufferID id = BufferID()) const;
 
   /// \returns the line number for the specified location
   /// If \p id is valid, \p loc must come from that source buffer.
   /// If \p id is invalid, the SourceManager will search for the correct source
   /// buffer.
   unsigned findLineNumber(SourceLoc loc, BufferID id = BufferID()) const {
-    assert(loc && "loc cannot be invalid");
-    return llvmSourceMgr.FindLineNumber(loc.value, id.value);
+    return getLineAndColumn(loc, id).first;
   }
 
   /// \returns the CharSourceRange that covers the entirety of \p buffer
   CharSourceRange getBufferCharSourceRange(BufferID buffer) const {
-    auto str = getBufferStr(buffer);
-    return CharSourceRange(SourceLoc::fromPointer(str.data()), str.size());
+    return CharSourceRange(getLineTable(buffer).beginLoc,
+                           getBufferStr(buffer).size());
   }
 
   /// \returns the name of the MemoryBuffer with \p id. If \p canonical is true,
@@ -97,6 +113,49 @@ public:
     assert(id && "id cannot be invalid!");
     return llvmSourceMgr.getMemoryBuffer(id.value)->getBufferIdentifier();
   }
+
+  /// Limits the SourceLoc address space, which is shared by every
+  /// SourceManager, to the offsets below \p maxOffset. Passing 0 restores the
+  /// default limit. This is only meant to be used by tests that need to reach
+  /// the end of the address space.
+  static void setSourceLocLimitForTesting(uint32_t maxOffset);
+
+private:
+  /// The line table of a buffer.
+  ///
+  /// Line tables are built when the buffer is given to the SourceManager, so
+  /// they can be used concurrently by multiple threads without locking.
+  struct LineTable {
+    LineTable(StringRef buffer, SourceLoc beginLoc);
+
+    /// The beginning of the buffer
+    const char *const begin;
+    /// The SourceLoc of the beginning of the buffer
+    const SourceLoc beginLoc;
+    /// The offset of each '\n' in the buffer, in ascending order.
+    std::vector<unsigned> newlineOffsets;
+    /// The index of the last line that was found in this buffer. Queries
+    /// often target the same line repeatedly (e.g. when emitting debug info
+    /// for every operation of a statement), so it's checked first.
+    mutable std::atomic<unsigned> lastLine{0};
+
+    /// \returns the (1-based) line and column of the character at \p offset.
+    std::pair<unsigned, unsigned> getLineAndColumn(unsigned offset) const;
+  };
+
+  /// \returns the LineTable of \p id
+  const LineTable &getLineTable(BufferID id) const {
+    assert(id && (id.value <= lineTables.size()) && "invalid buffer id");
+    return *lineTables[id.value - 1];
+  }
+
+  /// The line table of each buffer, indexed by BufferID - 1.
+  std::vector<std::unique_ptr<LineTable>> lineTables;
+  /// The buffers, sorted by beginLoc. This is used to find the buffer
+  /// containing a SourceLoc using a binary search. It isn't always sorted by
+  /// BufferID, because ranges of SourceLocs are reused once the end of the
+  /// address space has been reached.
+  std::vector<BufferID> buffersByLoc;
 };
 
 } // namespace sora
\ No newline at end of file
@@ -13,10 +13,13 @@
 #include "Sora/Common/LLVM.hpp"
 #include "Sora/Common/SourceLoc.hpp"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include <functional>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace sora {
 class SourceManager;
@@ -104,4 +107,37 @@ public:
 private:
   HandlerFunction func;
 };
+
+/// A DiagnosticConsumer that stores the diagnostics it handles so they can be
+/// replayed later, in the order in which they were received.
+///
+/// This is useful when diagnostics are emitted concurrently (e.g. when
+/// multiple files are processed on different threads), so they can be
+/// printed in a deterministic order once every thread is done.
+class BufferingDiagnosticConsumer : public DiagnosticConsumer {
+  /// A Diagnostic that owns its data.
+  struct StoredDiagnostic {
+    std::string message;
+    DiagnosticKind kind;
+    SourceLoc loc;
+    SmallVector<CharSourceRange, 2> ranges;
+    SmallVector<FixIt, 2> fixits;
+  };
+
+  std::vector<StoredDiagnostic> diagnostics;
+
+public:
+  /// Handles a diagnostic.
+  void handle(const SourceManager &srcMgr,
+              const Diagnostic &diagnostic) override;
+
+  /// \returns the number of diagnostics currently buffered.
+  size_t size() const { return diagnostics.size(); }
+  /// \returns true if no diagnostics are currently buffered.
+  bool empty() const { return diagnostics.empty(); }
+
+  /// Calls \p func on every buffered diagnostic, in the order in which they
+  /// were handled, then clears the buffer.
+  void flush(llvm::function_ref<void(const Diagnostic &)> func);
+};
 } // namespace sora
\ No newline at end of file
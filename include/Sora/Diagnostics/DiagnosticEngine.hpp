@@ -139,6 +139,11 @@ public:
     return InFlightDiagnostic(this);
   }
 
+  /// Emits \p diagnostic, an already formatted diagnostic, as if it had been
+  /// emitted by this DiagnosticEngine. This is used to replay diagnostics that
+  /// were buffered by another DiagnosticEngine.
+  void replay(const Diagnostic &diagnostic);
+
   /// \returns a observing pointer to the current diagnostic consumer
   DiagnosticConsumer *getConsumer() { return consumer.get(); }
 
@@ -19,12 +19,15 @@
 #include "Sora/Common/LLVM.hpp"
 #include "Sora/Common/SourceManager.hpp"
 #include "Sora/Diagnostics/DiagnosticEngine.hpp"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include <memory>
+#include <string>
 
 namespace mlir {
 class ModuleOp;
@@ -57,14 +60,13 @@ public:
     Sema,
     /// Sora IR Generation
     SIRGen,
-    /// Sora IR Transformations
-    /// (Not implemented yet - will likely be refactored)
+    /// Sora IR Transformations (e.g. promotion of stack slots to SSA values)
     SIRTransform,
-    /// Generation of LLVM IR from the MLIR module.
-    /// (Not implemented yet)
+    /// Generation and optimization of LLVM IR from the MLIR module, and
+    /// emission of the object file.
     LLVMGen,
     /// The last step of the process
-    Last = SIRGen
+    Last = LLVMGen
   };
 
   enum class ScopeMapPrintingMode : uint8_t {
@@ -80,7 +82,12 @@ public:
     /// Emit the MLIR Module. Its content depends on how many
     /// transformation/lowering passes were run.
     MLIRModule,
+    /// Emit the optimized LLVM IR Module.
+    LLVMModule,
+    /// Emit an object file.
+    ObjectFile,
     /// Emit a linked executable file
+    /// (Not implemented yet)
     Executable
   };
 
@@ -100,12 +107,34 @@ public:
     /// Whether debug information should be generated.
     /// Honored by doIRGen()
     bool genDebugInfo = false;
+    /// The optimization level (0 to 2).
+    /// Honored by doSIRTransform() and doLLVMGen()
+    unsigned optLevel = 0;
     /// Whether verify mode is enabled.
     /// Honored by run()
     bool verifyModeEnabled = false;
     /// Whether we should regularly print the memory usage of the ASTContext &
     /// other datastructures.
     bool printMemUsage = false;
+    /// Whether we should print the time spent on, and the peak memory used by
+    /// each input file once compilation is done.
+    bool printFileStats = false;
+    /// Whether we should time each step of the compilation process and print
+    /// a report once compilation is done.
+    bool printTimeReport = false;
+    /// If not empty, statistics are collected during compilation and written
+    /// to this file, as JSON, once compilation is done.
+    std::string statsJSONFile;
+    /// The maximum number of threads used to process input files, and to run
+    /// the SIR function passes.
+    /// 0 means that every available hardware thread can be used.
+    unsigned numThreads = 0;
+    /// The maximum number of threads used to type-check the function bodies
+    /// of each input file.
+    unsigned semaThreads = 1;
+    /// Input files of at least this many bytes are memory-mapped instead of
+    /// being copied into memory.
+    uint64_t mmapThreshold = SourceManager::defaultMMapThreshold;
     /// Scope Maps printing mode.
     /// Scope maps are printed by dumpScopeMaps().
     /// dumpScopeMaps is called by doSema or by doParsing if parseOnly is true.
@@ -141,11 +170,79 @@ public:
 
   SourceManager srcMgr;
   DiagnosticEngine diagEng;
-  std::unique_ptr<ASTContext> astContext;
 
 private:
+  /// An input file, and everything needed to parse and typecheck it
+  /// independently from other input files. This allows multiple input files to
+  /// be processed concurrently.
+  struct InputFile {
+    InputFile(const SourceManager &srcMgr, BufferID buffer);
+
+    InputFile(const InputFile &) = delete;
+    InputFile &operator=(const InputFile &) = delete;
+
+    /// Updates peakMemoryUsage with the current memory usage of the
+    /// ASTContext.
+    void updatePeakMemoryUsage();
+
+    /// Replays the diagnostics emitted while processing this file into \p
+    /// target, the CompilerInstance's DiagnosticEngine.
+    void replayDiagnostics(DiagnosticEngine &target);
+
+    /// The BufferID of this file
+    const BufferID buffer;
+    /// The DiagnosticEngine used while processing this file. Diagnostics are
+    /// buffered and must be replayed using replayDiagnostics.
+    DiagnosticEngine diagEng;
+    /// The ASTContext of this file
+    std::unique_ptr<ASTContext> astContext;
+    /// The SourceFile
+    SourceFile *sourceFile = nullptr;
+
+    /// The time spent parsing this file, in seconds.
+    double parsingTime = 0;
+    /// The time spent on the semantic analysis of this file, in seconds.
+    double semaTime = 0;
+    /// The time spent on the SIR generation of this file, in seconds.
+    double sirGenTime = 0;
+    /// The peak memory usage of this file's ASTContext, in bytes.
+    size_t peakMemoryUsage = 0;
+
+  private:
+    /// The consumer of diagEng, owned by diagEng.
+    BufferingDiagnosticConsumer *diagBuffer = nullptr;
+  };
+
+  /// The timers used to honor options.printTimeReport.
+  struct StepTimers {
+    StepTimers();
+
+    llvm::TimerGroup group;
+    llvm::Timer parsing;
+    llvm::Timer sema;
+    llvm::Timer astVerification;
+    llvm::Timer sirGen;
+    llvm::Timer sirVerification;
+    llvm::Timer sirTransform;
+    llvm::Timer mlirModuleEmission;
+    llvm::Timer llvmGen;
+    llvm::Timer llvmOptimization;
+    llvm::Timer llvmModuleEmission;
+    llvm::Timer objectEmission;
+  };
+
   bool hadFileLoadError = false;
 
+  /// The step timers. This is only non-null if options.printTimeReport is true.
+  /// The report is printed when this is destroyed.
+  std::unique_ptr<StepTimers> stepTimers;
+
+  /// \returns the timer \p timer of stepTimers, or nullptr if steps aren't
+  /// timed. The result is intended to be used with llvm::TimeRegion.
+  llvm::Timer *getStepTimer(llvm::Timer StepTimers::*timer) {
+    return stepTimers ? &((*stepTimers).*timer) : nullptr;
+  }
+
   /// Handles command-line options
   /// \param Driver the Driver to use to emit option parsing-related
   /// diagnostics.
@@ -168,21 +265,32 @@ private:
   /// \returns the installed DV, or nullptr if no DV was installed.
   DiagnosticVerifier *installDiagnosticVerifierIfNeeded();
 
-  /// Creates a SourceFile instance for \p buffer
-  SourceFile &createSourceFile(BufferID buffer);
+  /// Creates an InputFile (with its ASTContext and SourceFile) for each
+  /// input buffer.
+  void createInputFiles();
+
+  /// \returns the number of threads that should be used to process the input
+  /// files.
+  unsigned getNumThreads() const;
+
+  /// Calls \p func on each input file. If there are multiple input files and
+  /// multiple threads are allowed, the calls are made concurrently using a
+  /// thread pool, so \p func must only touch the state of the InputFile it's
+  /// given.
+  void forEachInputFile(llvm::function_ref<void(InputFile &)> func);
 
   /// Honors options.scopeMapPrintingMode for \p file.
   void dumpScopeMaps(raw_ostream &out, SourceFile &file);
 
-  /// Creates the ASTContext (if needed)
-  void createASTContext();
-
   /// Whether this CompilerInstance was ran at least once.
   bool ran = false;
 
   /// The BufferIDs of the input files.
   SmallVector<BufferID, 1> inputBuffers;
 
+  /// The input files, in the same order as inputBuffers.
+  SmallVector<std::unique_ptr<InputFile>, 1> inputFiles;
+
   /// The output stream where dumps (e.g. ast dumps) will be printed.
   raw_ostream &dump_os = llvm::outs();
 
@@ -190,21 +298,46 @@ private:
   /// process: object file, IR file, etc.
   std::unique_ptr<llvm::ToolOutputFile> outputFile;
 
-  /// Prints the memory usage of the ASTContext after \p step to debug_os.
-  void printASTContextMemoryUsage(Step step) const;
+  /// Prints the memory usage of the ASTContext of \p file after \p step to
+  /// dump_os.
+  void printASTContextMemoryUsage(Step step, const InputFile &file) const;
+
+  /// Prints the statistics of each input file to dump_os.
+  void printFileStatistics() const;
+
+  /// Writes the statistics collected during compilation to
+  /// options.statsJSONFile.
+  /// \returns false if the file couldn't be opened.
+  bool writeStatisticsJSON();
+
+  /// Diagnoses functions that are defined in more than one input file.
+  /// \returns false if such a function was found.
+  bool checkForFunctionsDefinedInMultipleFiles();
 
-  /// Performs the parsing step on \p file
+  /// Performs the parsing step on every input file.
   /// \returns false if errors were emitted during parsing
-  bool doParsing(SourceFile &file);
+  bool doParsing();
 
-  /// Performs the semantic analysis step on \p file
+  /// Performs the semantic analysis step on every input file.
   /// \returns false if errors were emitted during semantic analysis
-  bool doSema(SourceFile &file);
+  bool doSema();
 
-  /// Performs the SIR Generation step on \p file
+  /// Performs the SIR Generation step on every input file, emitting
+  /// everything in \p mlirModule.
   /// \returns false if errors were emitted during SIR Generation
-  bool doSIRGen(mlir::MLIRContext &mlirContext, mlir::ModuleOp &mlirModule,
-                SourceFile &file);
+  bool doSIRGen(mlir::MLIRContext &mlirContext, mlir::ModuleOp &mlirModule);
+
+  /// Performs the SIR Transformation step on \p mlirModule, running the
+  /// pass pipeline of options.optLevel.
+  /// \returns false if the transformations failed.
+  bool doSIRTransform(mlir::MLIRContext &mlirContext,
+                      mlir::ModuleOp &mlirModule);
+
+  /// Performs the LLVMGen step on \p mlirModule: lowers it to LLVM IR,
+  /// optimizes it at options.optLevel and emits the LLVM IR or the object
+  /// file, depending on options.desiredOutput.
+  /// \returns false if an error occured while doing so.
+  bool doLLVMGen(mlir::MLIRContext &mlirContext, mlir::ModuleOp &mlirModule);
 
   /// Emits mlirModule as a product of the compilation process.
   void emitMLIRModule(mlir::ModuleOp &mlirModule);
@@ -18,6 +18,16 @@
 
 #pragma once
 
+#include <memory>
+#include <string>
+
+namespace llvm {
+class Module;
+class raw_ostream;
+class raw_pwrite_stream;
+class TargetMachine;
+} // namespace llvm
+
 namespace mlir {
 class MLIRContext;
 class ModuleOp;
@@ -35,6 +45,14 @@ class SourceFile;
 /// \param isChecked whether the AST is type-checked.
 void verify(SourceFile &sf, bool isChecked);
 
+/// If statistics are enabled (see \c llvm::EnableStatistics), walks \p sf and
+/// counts its AST nodes, per kind, in the "AST" statistics.
+void collectASTStatistics(SourceFile &sf);
+
+/// Prints the number and size of the AST nodes of each kind in \p sf, and the
+/// size of its scope map, to \p out. The scope map isn't expanded.
+void printASTMemoryUsage(llvm::raw_ostream &out, SourceFile &sf);
+
 //===- Parser - Parsing Library -------------------------------------------===//
 
 /// Parses the content of \p sf
@@ -49,12 +67,17 @@ void parseSourceFile(SourceFile &sf);
 ///
 /// Memory will be allocated using the SourceFile's ASTContext, and Diagnostics
 /// will be emitted using the ASTContext's DiagnosticEngine.
-void performSema(SourceFile &sf);
+///
+/// If \p numThreads is greater than 1, function bodies are type-checked
+/// concurrently using up to \p numThreads threads. This doesn't change the
+/// diagnostics that are emitted, nor their order.
+void performSema(SourceFile &sf, unsigned numThreads = 1);
 
 //===- SIRGen - Sora IR Generation Library ---------------------------------===//
 
-/// Adds the MLIR Dialects necessary for SIRGen to MLIR's Dialect Registry.
-/// Currently, this adds the SIR, and MLIR's StandardOps dialects.
+/// Adds the MLIR Dialects necessary for SIRGen and LLVMGen to MLIR's Dialect
+/// Registry. Currently, this adds the SIR, and MLIR's StandardOps and LLVM
+/// dialects.
 ///
 /// This function must be called once before attempting any SIR Generation
 /// operation. This should only be called once.
@@ -74,6 +97,35 @@ mlir::ModuleOp createMLIRModule(mlir::MLIRContext &mlirCtxt, SourceFile &sf);
 void performSIRGen(mlir::MLIRContext &mlirCtxt, mlir::ModuleOp &mlirModule,
                    SourceFile &sf, bool enableDebugInfo);
 
+//===- LLVMGen - LLVM IR Generation Library -------------------------------===//
+
+/// Creates a TargetMachine generating code for the host at \p optLevel.
+/// \returns nullptr if the host isn't supported, setting \p error.
+std::unique_ptr<llvm::TargetMachine>
+createHostTargetMachine(unsigned optLevel, std::string &error);
+
+/// Lowers \p mlirModule, which must only contain SIR and StandardOps
+/// operations, to the LLVM dialect and translates it to LLVM IR for
+/// \p targetMachine.
+/// \returns the LLVM Module, or nullptr if \p mlirModule couldn't be lowered.
+/// In that case, diagnostics are emitted through \p mlirCtxt.
+///
+/// Note that \c registerMLIRDialects must be called before using this.
+std::unique_ptr<llvm::Module>
+performLLVMGen(mlir::MLIRContext &mlirCtxt, mlir::ModuleOp &mlirModule,
+               llvm::TargetMachine &targetMachine);
+
+/// Optimizes \p llvmModule using LLVM's default pipeline for \p optLevel.
+/// This does nothing at -O0.
+void performLLVMOptimizations(llvm::Module &llvmModule, unsigned optLevel,
+                              llvm::TargetMachine &targetMachine);
+
+/// Emits \p llvmModule as an object file in \p out.
+/// \returns false if \p targetMachine can't emit object files.
+bool emitObjectFile(llvm::Module &llvmModule,
+                    llvm::TargetMachine &targetMachine,
+                    llvm::raw_pwrite_stream &out);
+
 //===----------------------------------------------------------------------===//
 
 } // namespace sora
\ No newline at end of file
@@ -40,6 +40,7 @@ class Lexer {
 public:
   Lexer(const SourceManager &srcMgr, BufferID buffer,
         DiagnosticEngine *diagEng);
+  ~Lexer();
 
   /// Lex a token and return it.
   /// If we reached EOF, this will simply return the EOF token whenever
@@ -69,6 +70,13 @@ public:
   const SourceManager &srcMgr;
 
 private:
+  /// \returns the SourceLoc of \p ptr, which must be inside the buffer.
+  SourceLoc getLoc(const char *ptr) const {
+    assert(((begPtr <= ptr) && (ptr <= endPtr)) &&
+           "ptr is from a different buffer");
+    return begLoc.getAdvancedLoc(ptr - begPtr);
+  }
+
   void moveTo(const char *ptr) {
     assert(((begPtr <= ptr) && (ptr <= endPtr)) &&
            "ptr is from a different buffer");
@@ -84,16 +92,14 @@ private:
   diagnose(const char *loc, TypedDiag<Args...> diag,
            typename detail::PassArgument<Args>::type... args) {
     if (diagEng)
-      return diagEng->diagnose<Args...>(SourceLoc::fromPointer(loc), diag,
-                                        args...);
+      return diagEng->diagnose<Args...>(getLoc(loc), diag, args...);
     return InFlightDiagnostic();
   }
 
   /// Finishes lexing (sets nextToken = EOF and cur = end)
   void stopLexing() {
     assert(nextToken.isNot(TokenKind::EndOfFile) && "already EOF");
-    nextToken = Token(TokenKind::EndOfFile,
-                      CharSourceRange(SourceLoc::fromPointer(endPtr)),
+    nextToken = Token(TokenKind::EndOfFile, CharSourceRange(getLoc(endPtr)),
                       tokenIsAtStartOfLine);
     curPtr = endPtr;
   }
@@ -133,7 +139,8 @@ private:
   /// Creates a new token and puts it in nextToken.
   /// Sets tokenIsAtStartOfLine to false after pushing the token.
   void pushToken(TokenKind kind) {
-    nextToken = Token(kind, CharSourceRange::fromPointers(tokBegPtr, curPtr),
+    nextToken = Token(kind,
+                      CharSourceRange(getLoc(tokBegPtr), curPtr - tokBegPtr),
                       tokenIsAtStartOfLine);
     tokenIsAtStartOfLine = false;
   }
@@ -153,6 +160,10 @@ private:
   /// Whether the next token is at the start of a line.
   bool tokenIsAtStartOfLine = false;
 
+  /// The SourceLoc of begPtr. Tokens locs are computed from it instead of
+  /// using SourceLoc::fromPointer, which has to search the buffer.
+  SourceLoc begLoc;
+
   const char *begPtr = nullptr;
   const char *tokBegPtr = nullptr;
   const char *curPtr = nullptr;
@@ -160,5 +171,10 @@ private:
 
   /// The next token that'll be returned.
   Token nextToken;
+
+  /// The number of tokens returned by lex(). It's only added to the global
+  /// statistic when the Lexer is destroyed, as updating it is an atomic
+  /// operation.
+  unsigned tokensLexed = 0;
 };
 } // namespace sora
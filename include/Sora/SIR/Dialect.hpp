@@ -26,6 +26,11 @@ public:
   void printType(Type type, DialectAsmPrinter &os) const override;
   Type parseType(DialectAsmParser &parser) const override;
 
+  /// Materializes the constants created by the folders of SIR operations
+  /// as std.constant operations.
+  Operation *materializeConstant(OpBuilder &builder, Attribute value,
+                                 Type type, Location loc) override;
+
   static llvm::StringRef getDialectNamespace() { return "sir"; }
 };
 
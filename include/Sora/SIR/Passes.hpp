@@ -0,0 +1,47 @@
+//===--- Passes.hpp - Sora IR Passes ----------------------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class OpPassManager;
+class Pass;
+} // namespace mlir
+
+namespace sora {
+namespace sir {
+/// Creates a pass that promotes the non-escaping stack slots of functions
+/// (AllocStackOps that are only used by LoadOps and StoreOps) to SSA values
+/// and block arguments.
+std::unique_ptr<mlir::Pass> createMem2RegPass();
+
+/// Creates a pass that splits the non-escaping tuple stack slots of functions
+/// into one stack slot per tuple element, replacing the loads and stores of
+/// whole tuples with loads and stores of their elements.
+std::unique_ptr<mlir::Pass> createSROAPass();
+
+/// Creates a pass that lowers a module containing SIR and StandardOps
+/// operations to the LLVM dialect.
+std::unique_ptr<mlir::Pass> createLowerToLLVMPass();
+
+/// Adds the passes used to optimize Sora IR modules at \p optLevel to \p pm,
+/// which must operate on a ModuleOp.
+///   - 0: promotes stack slots to SSA values.
+///   - 1: also splits tuple stack slots (SROA) before promoting them,
+///     canonicalizes (using the SIR folders) and eliminates common
+///     subexpressions.
+///   - 2: also inlines functions and propagates constants (SCCP).
+void buildSIRPassPipeline(mlir::OpPassManager &pm, unsigned optLevel);
+
+/// Registers the Sora IR passes in MLIR's pass registry, so they can be used
+/// in textual pass pipelines (e.g. in sir-opt).
+/// This should only be called once.
+void registerSIRPasses();
+} // namespace sir
+} // namespace sora
@@ -9,27 +9,167 @@
 #include "Sora/AST/TypeVariableEnvironment.hpp"
 #include "Sora/AST/Types.hpp"
 #include "Sora/Common/LLVM.hpp"
+#include "Sora/Common/MemoryUsage.hpp"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/SmallVector.h"
-#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemAlloc.h"
+#include "llvm/Support/NativeFormatting.h"
+#include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <cstring>
+#include <mutex>
 #include <tuple>
 
 using namespace sora;
 
+#define DEBUG_TYPE "ASTContext"
+
+ALWAYS_ENABLED_STATISTIC(numIntegerTypesCreated, "# of IntegerTypes created");
+ALWAYS_ENABLED_STATISTIC(numReferenceTypesCreated,
+                         "# of ReferenceTypes created");
+ALWAYS_ENABLED_STATISTIC(numReferenceTypesReused,
+                         "# of ReferenceTypes found in the table");
+ALWAYS_ENABLED_STATISTIC(numMaybeTypesCreated, "# of MaybeTypes created");
+ALWAYS_ENABLED_STATISTIC(numMaybeTypesReused,
+                         "# of MaybeTypes found in the table");
+ALWAYS_ENABLED_STATISTIC(numTupleTypesCreated, "# of TupleTypes created");
+ALWAYS_ENABLED_STATISTIC(numLValueTypesCreated, "# of LValueTypes created");
+ALWAYS_ENABLED_STATISTIC(numLValueTypesReused,
+                         "# of LValueTypes found in the table");
+ALWAYS_ENABLED_STATISTIC(numFunctionTypesCreated, "# of FunctionTypes created");
+ALWAYS_ENABLED_STATISTIC(
+    numTypeVariableArenasReused,
+    "# of times a TypeVariableEnvironment arena was reused");
+
 //===- ASTContext::Impl ---------------------------------------------------===//
 
+namespace {
+/// The kinds of types that only wrap a single other type. They are uniqued
+/// in the same table, keyed on the wrapped type and this kind.
+enum class WrapperTypeKind : unsigned {
+  Maybe,
+  LValue,
+  Reference,
+  MutReference
+};
+
+/// The key of a wrapper type in the uniquing table.
+using WrapperTypeKey = llvm::PointerIntPair<TypeBase *, 2, WrapperTypeKind>;
+
+/// A string that's being interned, and its hash.
+struct IdentifierKey {
+  StringRef str;
+  unsigned hash;
+
+  IdentifierKey(StringRef str) : str(str), hash(llvm::djbHash(str)) {}
+};
+
+/// DenseMapInfo for the identifier table, which stores the headers of the
+/// identifiers and can be searched using an IdentifierKey.
+struct IdentifierTableInfo {
+  using Header = Identifier::Header;
+
+  static Header *getEmptyKey() {
+    return llvm::DenseMapInfo<Header *>::getEmptyKey();
+  }
+
+  static Header *getTombstoneKey() {
+    return llvm::DenseMapInfo<Header *>::getTombstoneKey();
+  }
+
+  static unsigned getHashValue(const Header *header) { return header->hash; }
+
+  static unsigned getHashValue(const IdentifierKey &key) { return key.hash; }
+
+  static bool isEqual(const Header *lhs, const Header *rhs) {
+    return lhs == rhs;
+  }
+
+  static bool isEqual(const IdentifierKey &lhs, const Header *rhs) {
+    if ((rhs == getEmptyKey()) || (rhs == getTombstoneKey()))
+      return false;
+    // Compare the hashes first so the strings rarely need to be compared.
+    return (lhs.hash == rhs->hash) && (lhs.str.size() == rhs->length) &&
+           !std::memcmp(lhs.str.data(), const_cast<Header *>(rhs)->getChars(),
+                        rhs->length);
+  }
+};
+
+/// \returns the size of \p type in bytes, including its trailing objects.
+size_t getTypeSize(const TypeBase *type) {
+  if (auto *tuple = dyn_cast<TupleType>(type))
+    return sizeof(TupleType) + (tuple->getNumElements() * sizeof(Type));
+  if (auto *fn = dyn_cast<FunctionType>(type))
+    return sizeof(FunctionType) + (fn->getNumArgs() * sizeof(Type));
+  switch (type->getKind()) {
+#define TYPE(KIND, PARENT)                                                     \
+  case TypeKind::KIND:                                                         \
+    return sizeof(KIND##Type);
+#include "Sora/AST/TypeNodes.def"
+  }
+  llvm_unreachable("Unknown TypeKind");
+}
+
+/// \returns the memory used by the buckets of \p set
+template <typename Ty> size_t getBucketsSize(const llvm::FoldingSet<Ty> &set) {
+  // FoldingSets have capacity() / 2 buckets, plus a sentinel one.
+  // capacity() isn't const for some reason, but doesn't change the set.
+  auto &mutableSet = const_cast<llvm::FoldingSet<Ty> &>(set);
+  return ((mutableSet.capacity() / 2) + 1) * sizeof(void *);
+}
+
+/// A builtin type: its name, and the ASTContext member that contains it.
+struct BuiltinTypeEntry {
+  StringRef name;
+  const CanType ASTContext::*type;
+};
+
+/// The table of builtin types, used by lookupBuiltinType and
+/// getAllBuiltinTypes. It's a static table so every ASTContext can use it
+/// without having to build anything.
+constexpr BuiltinTypeEntry builtinTypes[] = {
+#define BUILTIN_TYPE(T) {#T, &ASTContext::T##Type}
+    BUILTIN_TYPE(i8),    BUILTIN_TYPE(i16),   BUILTIN_TYPE(i32),
+    BUILTIN_TYPE(i64),   BUILTIN_TYPE(isize), BUILTIN_TYPE(u8),
+    BUILTIN_TYPE(u16),   BUILTIN_TYPE(u32),   BUILTIN_TYPE(u64),
+    BUILTIN_TYPE(usize), BUILTIN_TYPE(f32),   BUILTIN_TYPE(f64),
+    BUILTIN_TYPE(void),  BUILTIN_TYPE(bool),
+#undef BUILTIN_TYPE
+};
+} // namespace
+
 struct ASTContext::Impl {
-  /// The Identifier Table
-  /// FIXME: Ideally, this should use the permanent arena.
-  llvm::StringSet<llvm::BumpPtrAllocator> identifierTable;
+  /// The Identifier Table. The identifiers are allocated in the permanent
+  /// arena.
+  llvm::DenseSet<Identifier::Header *, IdentifierTableInfo> identifierTable;
+
+  /// \returns the identifier for \p key, interning it if needed.
+  /// The caller must hold the lock.
+  Identifier getIdentifier(const IdentifierKey &key) {
+    auto it = identifierTable.find_as(key);
+    if (it != identifierTable.end())
+      return Identifier((*it)->getChars());
+    void *mem = permanentArena.Allocate(
+        sizeof(Identifier::Header) + key.str.size() + 1,
+        alignof(Identifier::Header));
+    auto *header = new (mem)
+        Identifier::Header{key.hash, static_cast<unsigned>(key.str.size())};
+    char *chars = header->getChars();
+    std::memcpy(chars, key.str.data(), key.str.size());
+    chars[key.str.size()] = '\0';
+    identifierTable.insert_as(header, key);
+    return Identifier(chars);
+  }
 
   /// The set of cleanups that must be ran when the ASTContext is destroyed.
   SmallVector<std::function<void()>, 4> cleanups;
@@ -46,28 +186,52 @@ struct ASTContext::Impl {
       value += Arena::getTotalMemory();
       value += llvm::capacity_in_bytes(signedIntegerTypes);
       value += llvm::capacity_in_bytes(unsignedIntegerTypes);
-      value += llvm::capacity_in_bytes(referenceTypes);
-      value += llvm::capacity_in_bytes(maybeTypes);
-      // tupleTypes? FoldingSet doesn't provide a function to calculate the
-      // memory used.
-      value += llvm::capacity_in_bytes(lvalueTypes);
+      value += llvm::capacity_in_bytes(wrapperTypes);
+      value += getBucketsSize(tupleTypes);
+      value += getBucketsSize(functionTypes);
       return value;
     }
 
+    /// Adds the types uniqued in this arena to \p usage, which is indexed by
+    /// TypeKind.
+    void collectTypeMemoryUsage(MutableArrayRef<MemoryUsage> usage) const {
+      auto add = [&](const TypeBase *type) {
+        usage[size_t(type->getKind())].add(getTypeSize(type));
+      };
+      for (auto entry : signedIntegerTypes)
+        add(entry.second);
+      for (auto entry : unsignedIntegerTypes)
+        add(entry.second);
+      for (auto entry : wrapperTypes)
+        add(entry.second);
+      for (const TupleType &type : tupleTypes)
+        add(&type);
+      for (const FunctionType &type : functionTypes)
+        add(&type);
+    }
+
+    /// Frees everything allocated in this arena and empties the uniquing
+    /// tables, but keeps the first slab of the allocator and the capacity of
+    /// the tables so they can be reused.
+    void reset() {
+      Arena::Reset();
+      signedIntegerTypes.clear();
+      unsignedIntegerTypes.clear();
+      wrapperTypes.clear();
+      tupleTypes.clear();
+      functionTypes.clear();
+    }
+
     /// Signed Integer Types
     llvm::DenseMap<IntegerWidth::opaque_t, IntegerType *> signedIntegerTypes;
     /// Unsigned Integer Types
     llvm::DenseMap<IntegerWidth::opaque_t, IntegerType *> unsignedIntegerTypes;
-    /// Reference types
-    llvm::DenseMap<size_t, ReferenceType *> referenceTypes;
-    /// Maybe types
-    llvm::DenseMap<TypeBase *, MaybeType *> maybeTypes;
+    /// Reference, Maybe and LValue types
+    llvm::DenseMap<WrapperTypeKey, TypeBase *> wrapperTypes;
     /// Tuple types
     llvm::FoldingSet<TupleType> tupleTypes;
     /// Function types
     llvm::FoldingSet<FunctionType> functionTypes;
-    /// LValue types
-    llvm::DenseMap<TypeBase *, LValueType *> lvalueTypes;
   };
 
   /// for ArenaKind::Permanent
@@ -76,28 +240,77 @@ struct ASTContext::Impl {
   TupleType *emptyTupleType = nullptr;
   /// for ArenaKind::UnresolvedExpr
   llvm::BumpPtrAllocator unresolvedExprArena;
-  /// for ArenaKind::TypeVariableEnvironment
-  Optional<TypeArena> typeVariableEnvironmentArena;
-  TypeVariableEnvironment *currentTypeVariableEnvironment = nullptr;
 
-  // Built-in types lookup map
-  llvm::DenseMap<Identifier, CanType> builtinTypesLookupMap;
+  /// The TypeVariableEnvironment that is active on a thread, and its arena.
+  struct TypeVariableEnvironmentState {
+    /// The Impl of the ASTContext that owns the environment
+    const Impl *owner = nullptr;
+    TypeVariableEnvironment *env = nullptr;
+    /// for ArenaKind::TypeVariableEnvironment
+    /// This is created by the first TypeVariableEnvironment of the thread,
+    /// then reset and reused by the next ones, as a lot of environments are
+    /// usually created during type-checking (one per expression).
+    Optional<TypeArena> arena;
+    /// Whether the arena is being used by a TypeVariableEnvironment.
+    bool active = false;
+  };
+  /// This is thread-local so that, in thread-safe mode, every thread can have
+  /// its own TypeVariableEnvironment. A thread can only have one active
+  /// TypeVariableEnvironment at a time.
+  static thread_local TypeVariableEnvironmentState typeVarEnvState;
+
+  /// Whether thread-safe mode is enabled.
+  bool threadSafe = false;
+  /// In thread-safe mode, guards the Permanent & UnresolvedExpr arenas, the
+  /// uniquing tables of the Permanent arena, the identifier table and the
+  /// cleanups. This is recursive because types are allocated while their
+  /// uniquing table is locked.
+  std::recursive_mutex mutex;
+
+  /// In thread-safe mode, locks the mutex. Else, does nothing.
+  std::unique_lock<std::recursive_mutex> lock() {
+    if (!threadSafe)
+      return {};
+    return std::unique_lock<std::recursive_mutex>(mutex);
+  }
+
+  /// Same as lock(), but doesn't do anything if \p kind is
+  /// ArenaKind::TypeVariableEnvironment, as that arena is thread-local.
+  std::unique_lock<std::recursive_mutex> lock(ArenaKind kind) {
+    if (kind == ArenaKind::TypeVariableEnvironment)
+      return {};
+    return lock();
+  }
 
   void initTypeVariableEnvironmentArena(TypeVariableEnvironment &env) {
-    assert(!hasTypeVariableEnvironmentArena() &&
+    assert(!typeVarEnvState.active &&
            "TypeVariableEnvironment arena already active");
-    currentTypeVariableEnvironment = &env;
-    typeVariableEnvironmentArena.emplace();
+    typeVarEnvState.owner = this;
+    typeVarEnvState.env = &env;
+    typeVarEnvState.active = true;
+    if (typeVarEnvState.arena)
+      ++numTypeVariableArenasReused;
+    else
+      typeVarEnvState.arena.emplace();
   }
 
   void destroyTypeVariableEnvironmentArena() {
     assert(hasTypeVariableEnvironmentArena() &&
            "TypeVariableEnvironment arena not active");
-    typeVariableEnvironmentArena.reset();
+    typeVarEnvState.arena->reset();
+    typeVarEnvState.active = false;
+    typeVarEnvState.env = nullptr;
+    typeVarEnvState.owner = nullptr;
   }
 
   bool hasTypeVariableEnvironmentArena() const {
-    return typeVariableEnvironmentArena.hasValue();
+    return (typeVarEnvState.owner == this) && typeVarEnvState.active;
+  }
+
+  /// \returns the TypeVariableEnvironment active on the current thread, or
+  /// nullptr if there is none.
+  TypeVariableEnvironment *getCurrentTypeVariableEnvironment() const {
+    return (typeVarEnvState.owner == this) ? typeVarEnvState.env : nullptr;
   }
 
   /// \returns the TypeArena for \p kind. \p kind can't be UnresolvedExpr!
@@ -108,7 +321,7 @@ struct ASTContext::Impl {
     case ArenaKind::TypeVariableEnvironment:
       assert(hasTypeVariableEnvironmentArena() &&
              "TypeVariableEnvironment allocator isn't active!");
-      return *typeVariableEnvironmentArena;
+      return *typeVarEnvState.arena;
     case ArenaKind::UnresolvedExpr:
       llvm_unreachable(
           "Can't allocate types inside the UnresolvedExpr allocator!");
@@ -144,9 +357,12 @@ struct ASTContext::Impl {
   }
 };
 
+thread_local ASTContext::Impl::TypeVariableEnvironmentState
+    ASTContext::Impl::typeVarEnvState;
+
 size_t ASTContext::Impl::getTotalMemoryUsed() const {
   size_t value = sizeof(Impl);
-  value += identifierTable.getAllocator().getTotalMemory();
+  value += identifierTable.getMemorySize();
   value += llvm::capacity_in_bytes(cleanups);
   value += getMemoryUsed(ArenaKind::Permanent);
   value += getMemoryUsed(ArenaKind::UnresolvedExpr);
@@ -161,9 +377,9 @@ size_t ASTContext::Impl::getMemoryUsed(ArenaKind arena) const {
   case ArenaKind::UnresolvedExpr:
     return unresolvedExprArena.getTotalMemory();
   case ArenaKind::TypeVariableEnvironment:
-    if (!typeVariableEnvironmentArena)
+    if (!hasTypeVariableEnvironmentArena())
       return 0;
-    return typeVariableEnvironmentArena->getTotalMemory();
+    return typeVarEnvState.arena->getTotalMemory();
   }
   llvm_unreachable("Unknown ArenaKind");
 }
@@ -202,35 +418,7 @@ ASTContext::ASTContext(const SourceManager &srcMgr,
                   FloatType(*this, FloatKind::IEEE64)),
       voidType(new (*this, ArenaKind::Permanent) VoidType(*this)),
       boolType(new (*this, ArenaKind::Permanent) BoolType(*this)),
-      errorType(new (*this, ArenaKind::Permanent) ErrorType(*this)) {
-  // Build the BuiltinTypes lookup map
-  // FIXME: Can't this be built lazily?
-  buildBuiltinTypesLookupMap();
-}
-
-void ASTContext::buildBuiltinTypesLookupMap() {
-  auto &map = getImpl().builtinTypesLookupMap;
-  assert(map.empty() && "BuiltinTypes lookup map already created");
-#define BUILTIN_TYPE(T) map.insert({getIdentifier(#T), T##Type})
-  BUILTIN_TYPE(i8);
-  BUILTIN_TYPE(i16);
-  BUILTIN_TYPE(i32);
-  BUILTIN_TYPE(i64);
-  BUILTIN_TYPE(isize);
-
-  BUILTIN_TYPE(u8);
-  BUILTIN_TYPE(u16);
-  BUILTIN_TYPE(u32);
-  BUILTIN_TYPE(u64);
-  BUILTIN_TYPE(usize);
-
-  BUILTIN_TYPE(f32);
-  BUILTIN_TYPE(f64);
-
-  BUILTIN_TYPE(void);
-  BUILTIN_TYPE(bool);
-#undef BUILTIN_TYPE
-}
+      errorType(new (*this, ArenaKind::Permanent) ErrorType(*this)) {}
 
 ASTContext::Impl &ASTContext::getImpl() {
   return *reinterpret_cast<Impl *>(
@@ -289,15 +477,26 @@ llvm::BumpPtrAllocator &ASTContext::getArena(ArenaKind kind) {
   case ArenaKind::TypeVariableEnvironment:
     assert(getImpl().hasTypeVariableEnvironmentArena() &&
            "TypeVariableEnvironment arena not active!");
-    return *getImpl().typeVariableEnvironmentArena;
+    return *getImpl().typeVarEnvState.arena;
   }
   llvm_unreachable("unknown allocator kind");
 }
 
+void *ASTContext::allocate(size_t size, size_t align, ArenaKind allocator) {
+  if (!size)
+    return nullptr;
+  auto lock = getImpl().lock(allocator);
+  return getArena(allocator).Allocate(size, align);
+}
+
 bool ASTContext::hasTypeVariableEnvironmentArena() const {
   return getImpl().hasTypeVariableEnvironmentArena();
 }
 
+void ASTContext::setThreadSafe(bool value) { getImpl().threadSafe = value; }
+
+bool ASTContext::isThreadSafe() const { return getImpl().threadSafe; }
+
 void ASTContext::freeUnresolvedExprs() {
   getImpl().unresolvedExprArena.Reset();
 }
@@ -312,14 +511,68 @@ size_t ASTContext::getMemoryUsed(ArenaKind arena) const {
   return getImpl().getMemoryUsed(arena);
 }
 
+void ASTContext::printMemoryUsage(raw_ostream &out) const {
+  const Impl &impl = getImpl();
+  auto printBytes = [&](size_t bytes) {
+    llvm::write_integer(out, bytes, 0, llvm::IntegerStyle::Number);
+    out << " bytes";
+  };
+
+  out << "  identifier table: " << impl.identifierTable.size()
+      << " identifiers, ";
+  printBytes(impl.identifierTable.getMemorySize());
+  out << " (the identifiers are in the permanent arena)\n";
+
+  auto printArena = [&](StringRef name, const Impl::Arena &arena) {
+    size_t total = arena.getTotalMemory();
+    size_t allocated = arena.getBytesAllocated();
+    out << "  " << name << " arena: ";
+    printBytes(total);
+    out << " in " << arena.GetNumSlabs() << " slab(s), ";
+    printBytes(allocated);
+    out << " allocated, ";
+    printBytes((total > allocated) ? (total - allocated) : 0);
+    out << " unused\n";
+  };
+  printArena("permanent", impl.permanentArena);
+  printArena("unresolved expression", impl.unresolvedExprArena);
+  if (impl.hasTypeVariableEnvironmentArena())
+    printArena("type variable environment", *impl.typeVarEnvState.arena);
+
+  // TypeVariableTypes aren't uniqued, so they aren't counted here.
+  static constexpr size_t numTypeKinds = size_t(TypeKind::Last_Type) + 1;
+  static const char *const typeKindNames[numTypeKinds] = {
+#define TYPE(KIND, PARENT) #KIND "Type",
+#include "Sora/AST/TypeNodes.def"
+  };
+  MemoryUsage typeUsage[numTypeKinds];
+  impl.permanentArena.collectTypeMemoryUsage(typeUsage);
+  if (impl.hasTypeVariableEnvironmentArena())
+    impl.typeVarEnvState.arena->collectTypeMemoryUsage(typeUsage);
+  // Types that are created once, and thus not in the uniquing tables.
+  for (CanType type : {f32Type, f64Type, voidType, boolType, errorType})
+    typeUsage[size_t(type->getKind())].add(getTypeSize(type.getPtr()));
+  if (impl.emptyTupleType)
+    typeUsage[size_t(TypeKind::Tuple)].add(getTypeSize(impl.emptyTupleType));
+
+  out << "  types:\n";
+  for (size_t kind = 0; kind < numTypeKinds; ++kind)
+    typeUsage[kind].print(out, typeKindNames[kind], /*indent*/ 4);
+}
+
 void ASTContext::addCleanup(std::function<void()> cleanup) {
+  auto lock = getImpl().lock();
   getImpl().cleanups.push_back(cleanup);
 }
 
 Identifier ASTContext::getIdentifier(StringRef str) {
   // Don't intern null & empty strings
-  return str.size() ? getImpl().identifierTable.insert(str).first->getKeyData()
-                    : Identifier();
+  if (str.empty())
+    return Identifier();
+  // Hash the string before taking the lock.
+  IdentifierKey key(str);
+  auto lock = getImpl().lock();
+  return getImpl().getIdentifier(key);
 }
 
 void ASTContext::overrideTargetTriple(const llvm::Triple &triple) {
@@ -333,45 +586,49 @@ llvm::Triple ASTContext::getTargetTriple() const {
 CanType ASTContext::lookupBuiltinType(Identifier ident) const {
   if (!ident)
     return CanType(nullptr);
-  auto &map = getImpl().builtinTypesLookupMap;
-  auto it = map.find(ident);
-  if (it == map.end())
-    return CanType(nullptr);
-  return it->second;
+  // StringRef's == compares the lengths before the characters, so most
+  // entries are rejected without touching the identifier's characters.
+  StringRef name = ident.str();
+  for (const BuiltinTypeEntry &entry : builtinTypes)
+    if (entry.name == name)
+      return this->*entry.type;
+  return CanType(nullptr);
 }
 
 void ASTContext::getAllBuiltinTypes(SmallVectorImpl<Type> &results) const {
-  auto &map = getImpl().builtinTypesLookupMap;
-  results.reserve(map.size());
-  for (auto entry : map)
-    results.push_back(entry.second);
+  results.reserve(results.size() + llvm::array_lengthof(builtinTypes));
+  for (const BuiltinTypeEntry &entry : builtinTypes)
+    results.push_back(this->*entry.type);
 }
 
 void ASTContext::getAllBuiltinTypes(SmallVectorImpl<CanType> &results) const {
-  auto &map = getImpl().builtinTypesLookupMap;
-  results.reserve(map.size());
-  for (auto entry : map)
-    results.push_back(entry.second);
+  results.reserve(results.size() + llvm::array_lengthof(builtinTypes));
+  for (const BuiltinTypeEntry &entry : builtinTypes)
+    results.push_back(this->*entry.type);
 }
 
 //===- IntegerType --------------------------------------------------------===//
 
 IntegerType *IntegerType::getSigned(ASTContext &ctxt, IntegerWidth width) {
+  auto lock = ctxt.getImpl().lock();
   IntegerType *&ty = ctxt.getImpl()
                          .getTypeArena(ArenaKind::Permanent)
                          .signedIntegerTypes[width.getOpaqueValue()];
   if (ty)
     return ty;
+  ++numIntegerTypesCreated;
   return ty = (new (ctxt, ArenaKind::Permanent)
                    IntegerType(ctxt, width, /*isSigned*/ true));
 }
 
 IntegerType *IntegerType::getUnsigned(ASTContext &ctxt, IntegerWidth width) {
+  auto lock = ctxt.getImpl().lock();
   IntegerType *&ty = ctxt.getImpl()
                          .getTypeArena(ArenaKind::Permanent)
                          .unsignedIntegerTypes[width.getOpaqueValue()];
   if (ty)
     return ty;
+  ++numIntegerTypesCreated;
   return ty = (new (ctxt, ArenaKind::Permanent)
                    IntegerType(ctxt, width, /*isSigned*/ false));
 }
@@ -382,15 +639,21 @@ ReferenceType *ReferenceType::get(Type pointee, bool isMut) {
   assert(pointee && "pointee type can't be null!");
   ASTContext &ctxt = pointee->getASTContext();
 
-  size_t typeID = llvm::hash_combine(pointee.getPtr(), isMut);
   auto props = pointee->getTypeProperties();
   auto arena = getArena(props);
-
-  ReferenceType *&type =
-      ctxt.getImpl().getTypeArena(arena).referenceTypes[typeID];
-  if (type)
-    return type;
-  return type = new (ctxt, arena) ReferenceType(props, ctxt, pointee, isMut);
+  WrapperTypeKey key(pointee.getPtr(), isMut ? WrapperTypeKind::MutReference
+                                             : WrapperTypeKind::Reference);
+
+  auto lock = ctxt.getImpl().lock(arena);
+  TypeBase *&type = ctxt.getImpl().getTypeArena(arena).wrapperTypes[key];
+  if (type) {
+    ++numReferenceTypesReused;
+    return cast<ReferenceType>(type);
+  }
+  ++numReferenceTypesCreated;
+  auto *result = new (ctxt, arena) ReferenceType(props, ctxt, pointee, isMut);
+  type = result;
+  return result;
 }
 
 //===- MaybeType ----------------------------------------------------------===//
@@ -402,12 +665,18 @@ MaybeType *MaybeType::get(Type valueType) {
   auto props = valueType->getTypeProperties();
   auto arena = getArena(props);
 
-  MaybeType *&type =
-      ctxt.getImpl().getTypeArena(arena).maybeTypes[valueType.getPtr()];
+  WrapperTypeKey key(valueType.getPtr(), WrapperTypeKind::Maybe);
 
-  if (type)
-    return type;
-  return type = new (ctxt, arena) MaybeType(props, ctxt, valueType);
+  auto lock = ctxt.getImpl().lock(arena);
+  TypeBase *&type = ctxt.getImpl().getTypeArena(arena).wrapperTypes[key];
+  if (type) {
+    ++numMaybeTypesReused;
+    return cast<MaybeType>(type);
+  }
+  ++numMaybeTypesCreated;
+  auto *result = new (ctxt, arena) MaybeType(props, ctxt, valueType);
+  type = result;
+  return result;
 }
 
 //===- TupleType ----------------------------------------------------------===//
@@ -433,7 +702,9 @@ Type TupleType::get(ASTContext &ctxt, ArrayRef<Type> elems) {
     props |= elem->getTypeProperties();
   }
 
-  auto &typeArena = ctxt.getImpl().getTypeArena(getArena(props));
+  auto arena = getArena(props);
+  auto lock = ctxt.getImpl().lock(arena);
+  auto &typeArena = ctxt.getImpl().getTypeArena(arena);
   void *insertPos = nullptr;
   llvm::FoldingSetNodeID id;
   Profile(id, elems);
@@ -446,10 +717,12 @@ Type TupleType::get(ASTContext &ctxt, ArrayRef<Type> elems) {
                                  alignof(TupleType));
   TupleType *type = new (mem) TupleType(props, ctxt, isCanonical, elems);
   set.InsertNode(type, insertPos);
+  ++numTupleTypesCreated;
   return type;
 }
 
 TupleType *TupleType::getEmpty(ASTContext &ctxt) {
+  auto lock = ctxt.getImpl().lock();
   TupleType *&type = ctxt.getImpl().emptyTupleType;
   if (type)
     return type;
@@ -466,11 +739,18 @@ LValueType *LValueType::get(Type objectType) {
   auto props = objectType->getTypeProperties() | TypeProperties::hasLValue;
   auto arena = getArena(props);
 
-  LValueType *&type =
-      ctxt.getImpl().getTypeArena(arena).lvalueTypes[objectType.getPtr()];
-  if (type)
-    return type;
-  return type = new (ctxt, arena) LValueType(props, ctxt, objectType);
+  WrapperTypeKey key(objectType.getPtr(), WrapperTypeKind::LValue);
+
+  auto lock = ctxt.getImpl().lock(arena);
+  TypeBase *&type = ctxt.getImpl().getTypeArena(arena).wrapperTypes[key];
+  if (type) {
+    ++numLValueTypesReused;
+    return cast<LValueType>(type);
+  }
+  ++numLValueTypesCreated;
+  auto *result = new (ctxt, arena) LValueType(props, ctxt, objectType);
+  type = result;
+  return result;
 }
 
 //===- FunctionType -------------------------------------------------------===//
@@ -487,7 +767,9 @@ FunctionType *FunctionType::get(ArrayRef<Type> args, Type rtr) {
     props |= arg->getTypeProperties();
   }
 
-  auto &typeArena = ctxt.getImpl().getTypeArena(getArena(props));
+  auto arena = getArena(props);
+  auto lock = ctxt.getImpl().lock(arena);
+  auto &typeArena = ctxt.getImpl().getTypeArena(arena);
 
   void *insertPos = nullptr;
   llvm::FoldingSetNodeID id;
@@ -502,6 +784,7 @@ FunctionType *FunctionType::get(ArrayRef<Type> args, Type rtr) {
   FunctionType *type =
       new (mem) FunctionType(props, ctxt, isCanonical, args, rtr);
   set.InsertNode(type, insertPos);
+  ++numFunctionTypesCreated;
   return type;
 }
 
@@ -526,7 +809,7 @@ TypeVariableEnvironment::~TypeVariableEnvironment() {
 
 const TypeVariableEnvironment &TypeVariableType::getEnvironment() const {
   TypeVariableEnvironment *env =
-      getASTContext().getImpl().currentTypeVariableEnvironment;
+      getASTContext().getImpl().getCurrentTypeVariableEnvironment();
   assert(env && "A TypeVariable is alive without a TypeVariableEnvironment?!");
   return *env;
 }
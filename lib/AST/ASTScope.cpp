@@ -13,14 +13,24 @@
 #include "Sora/AST/SourceFile.hpp"
 #include "Sora/AST/Stmt.hpp"
 #include "Sora/Lexer/Lexer.hpp"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace sora;
 
+#define DEBUG_TYPE "ASTScope"
+
+ALWAYS_ENABLED_STATISTIC(numScopesCreated, "# of ASTScopes created");
+ALWAYS_ENABLED_STATISTIC(numScopesExpanded, "# of ASTScopes expanded");
+
 //===- ASTScope -----------------------------------------------------------===//
 
 void *ASTScope::operator new(size_t size, ASTContext &ctxt, unsigned align) {
+  // Updating a statistic is an atomic operation, so only do it when someone
+  // is going to look at the count.
+  if (llvm::AreStatisticsEnabled())
+    ++numScopesCreated;
   return ctxt.allocate(size, align, ArenaKind::Permanent);
 }
 
@@ -68,6 +78,10 @@ void ASTScope::addChild(ASTScope *scope) {
 }
 
 ASTScope *ASTScope::findInnermostScope(SourceLoc loc) {
+  if (SourceFileScope *sfScope = dyn_cast<SourceFileScope>(this))
+    if (sfScope->hasIntervalIndex())
+      return sfScope->findInnermostScopeInIndex(loc);
+
   expand();
 
   // Find the children in which loc belongs.
@@ -97,29 +111,17 @@ void ASTScope::fullyExpand() {
     child->fullyExpand();
 }
 
-SourceLoc ASTScope::getBegLoc() const {
-  switch (getKind()) {
-#define SCOPE(ID)                                                              \
-  case ASTScopeKind::ID:                                                       \
-    return ASTNodeLoc<ASTScope, ID##Scope, false>::getBegLoc(                  \
-        cast<ID##Scope>(this));
-#include "Sora/AST/ASTScopeKinds.def"
-  }
-  llvm_unreachable("unknown ASTScopeKind");
-}
+SourceLoc ASTScope::getBegLoc() const { return getSourceRange().begin; }
 
-SourceLoc ASTScope::getEndLoc() const {
-  switch (getKind()) {
-#define SCOPE(ID)                                                              \
-  case ASTScopeKind::ID:                                                       \
-    return ASTNodeLoc<ASTScope, ID##Scope, false>::getEndLoc(                  \
-        cast<ID##Scope>(this));
-#include "Sora/AST/ASTScopeKinds.def"
-  }
-  llvm_unreachable("unknown ASTScopeKind");
-}
+SourceLoc ASTScope::getEndLoc() const { return getSourceRange().end; }
 
 SourceRange ASTScope::getSourceRange() const {
+  if (cachedRange)
+    return cachedRange;
+  return computeSourceRange();
+}
+
+SourceRange ASTScope::computeSourceRange() const {
   switch (getKind()) {
 #define SCOPE(ID)                                                              \
   case ASTScopeKind::ID:                                                       \
@@ -244,6 +246,8 @@ void ASTScope::expand() {
   // If we already expanded, we don't need to do anything.
   if (expanded)
     return;
+  if (llvm::AreStatisticsEnabled())
+    ++numScopesExpanded;
   // Dispatch
   switch (getKind()) {
   case ASTScopeKind::SourceFile: {
@@ -304,12 +308,80 @@ SourceFileScope *SourceFileScope::create(SourceFile &sf) {
   return new (sf.astContext) SourceFileScope(sf);
 }
 
+namespace {
+/// Flattens a fully expanded scope map into a list of IntervalIndexEntry
+/// sorted by SourceLoc.
+class IntervalIndexBuilder {
+  using Entry = SourceFileScope::IntervalIndexEntry;
+  SmallVector<Entry, 32> entries;
+
+  /// Adds an entry. If the last entry begins at the same loc, it is replaced,
+  /// so the scope that was pushed last wins.
+  void push(SourceLoc begin, ASTScope *scope) {
+    if (!entries.empty()) {
+      assert(entries.back().begin <= begin && "entries aren't sorted!");
+      if (entries.back().begin == begin) {
+        entries.back().scope = scope;
+        return;
+      }
+    }
+    entries.push_back({begin, scope});
+  }
+
+  void visitChildren(ASTScope *scope) {
+    for (ASTScope *child : scope->getChildren()) {
+      SourceRange range = child->getSourceRange();
+      if (range.isInvalid())
+        continue;
+      push(range.begin, child);
+      visitChildren(child);
+      // Past the end of the child, we're back inside the parent.
+      push(range.end.getAdvancedLoc(1), scope);
+    }
+  }
+
+public:
+  ArrayRef<Entry> build(SourceFileScope *root) {
+    visitChildren(root);
+    ASTContext &ctxt = root->getASTContext();
+    Entry *mem = static_cast<Entry *>(
+        ctxt.allocate(sizeof(Entry) * entries.size(), alignof(Entry)));
+    std::uninitialized_copy(entries.begin(), entries.end(), mem);
+    return {mem, entries.size()};
+  }
+};
+} // namespace
+
+void SourceFileScope::buildIntervalIndex() {
+  if (indexBuilt)
+    return;
+  fullyExpand();
+  intervalIndex = IntervalIndexBuilder().build(this);
+  indexBuilt = true;
+}
+
+ASTScope *SourceFileScope::findInnermostScopeInIndex(SourceLoc loc) const {
+  assert(hasIntervalIndex() && "no interval index!");
+  // Find the last entry that begins at or before loc.
+  auto it = std::upper_bound(
+      intervalIndex.begin(), intervalIndex.end(), loc,
+      [](SourceLoc loc, const IntervalIndexEntry &entry) {
+        return loc < entry.begin;
+      });
+  // If loc is before every entry, it's directly inside the SourceFile.
+  if (it == intervalIndex.begin())
+    return const_cast<SourceFileScope *>(this);
+  return std::prev(it)->scope;
+}
+
 SourceLoc SourceFileScope::getBegLoc() const { return sourceFile.getBegLoc(); }
 
 SourceLoc SourceFileScope::getEndLoc() const { return sourceFile.getEndLoc(); }
 
 FuncDeclScope *FuncDeclScope::create(FuncDecl *func, ASTScope *parent) {
-  return new (func->getASTContext()) FuncDeclScope(func, parent);
+  auto *scope = new (func->getASTContext()) FuncDeclScope(func, parent);
+  scope->cacheSourceRange();
+  return scope;
 }
 
 SourceLoc FuncDeclScope::getBegLoc() const { return decl->getBegLoc(); }
@@ -322,12 +394,17 @@ bool LocalLetDeclScope::isLocalAndNonNull() const {
 
 LocalLetDeclScope *LocalLetDeclScope::create(LetDecl *decl, ASTScope *parent,
                                              SourceRange range) {
-  return new (decl->getASTContext()) LocalLetDeclScope(decl, parent, range);
+  auto *scope =
+      new (decl->getASTContext()) LocalLetDeclScope(decl, parent, range);
+  scope->cacheSourceRange();
+  return scope;
 }
 
 BlockStmtScope *BlockStmtScope::create(ASTContext &ctxt, BlockStmt *stmt,
                                        ASTScope *parent) {
-  return new (ctxt) BlockStmtScope(stmt, parent);
+  auto *scope = new (ctxt) BlockStmtScope(stmt, parent);
+  scope->cacheSourceRange();
+  return scope;
 }
 
 SourceLoc BlockStmtScope::getBegLoc() const {
@@ -340,7 +417,9 @@ SourceLoc BlockStmtScope::getEndLoc() const {
 
 IfStmtScope *IfStmtScope::create(ASTContext &ctxt, IfStmt *stmt,
                                  ASTScope *parent) {
-  return new (ctxt) IfStmtScope(stmt, parent);
+  auto *scope = new (ctxt) IfStmtScope(stmt, parent);
+  scope->cacheSourceRange();
+  return scope;
 }
 
 SourceLoc IfStmtScope::getBegLoc() const { return getIfStmt()->getBegLoc(); }
@@ -349,7 +428,9 @@ SourceLoc IfStmtScope::getEndLoc() const { return getIfStmt()->getEndLoc(); }
 
 WhileStmtScope *WhileStmtScope::create(ASTContext &ctxt, WhileStmt *stmt,
                                        ASTScope *parent) {
-  return new (ctxt) WhileStmtScope(stmt, parent);
+  auto *scope = new (ctxt) WhileStmtScope(stmt, parent);
+  scope->cacheSourceRange();
+  return scope;
 }
 
 SourceLoc WhileStmtScope::getBegLoc() const {
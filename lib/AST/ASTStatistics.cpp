@@ -0,0 +1,250 @@
+//===--- ASTStatistics.cpp - AST Node Statistics ----------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+
+#include "Sora/AST/ASTScope.hpp"
+#include "Sora/AST/ASTWalker.hpp"
+#include "Sora/AST/Decl.hpp"
+#include "Sora/AST/Expr.hpp"
+#include "Sora/AST/Pattern.hpp"
+#include "Sora/AST/SourceFile.hpp"
+#include "Sora/AST/Stmt.hpp"
+#include "Sora/AST/TypeRepr.hpp"
+#include "Sora/Common/MemoryUsage.hpp"
+#include "Sora/EntryPoints.hpp"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace sora;
+
+#define DEBUG_TYPE "AST"
+
+#define DECL(KIND, PARENT)                                                     \
+  ALWAYS_ENABLED_STATISTIC(num##KIND##Decls, "# of " #KIND "Decl nodes");
+#include "Sora/AST/DeclNodes.def"
+#define EXPR(KIND, PARENT)                                                     \
+  ALWAYS_ENABLED_STATISTIC(num##KIND##Exprs, "# of " #KIND "Expr nodes");
+#include "Sora/AST/ExprNodes.def"
+#define PATTERN(KIND, PARENT)                                                  \
+  ALWAYS_ENABLED_STATISTIC(num##KIND##Patterns, "# of " #KIND "Pattern nodes");
+#include "Sora/AST/PatternNodes.def"
+#define STMT(KIND, PARENT)                                                     \
+  ALWAYS_ENABLED_STATISTIC(num##KIND##Stmts, "# of " #KIND "Stmt nodes");
+#include "Sora/AST/StmtNodes.def"
+#define TYPEREPR(KIND, PARENT)                                                 \
+  ALWAYS_ENABLED_STATISTIC(num##KIND##TypeReprs,                               \
+                           "# of " #KIND "TypeRepr nodes");
+#include "Sora/AST/TypeReprNodes.def"
+
+namespace {
+/// Walks the AST and increments the statistic of every node it visits.
+struct ASTStatisticsCollector : public ASTWalker {
+  Action walkToDeclPre(Decl *decl) override {
+    switch (decl->getKind()) {
+#define DECL(KIND, PARENT)                                                     \
+  case DeclKind::KIND:                                                         \
+    ++num##KIND##Decls;                                                        \
+    break;
+#include "Sora/AST/DeclNodes.def"
+    }
+    return Action::Continue;
+  }
+
+  std::pair<Action, Expr *> walkToExprPre(Expr *expr) override {
+    switch (expr->getKind()) {
+#define EXPR(KIND, PARENT)                                                     \
+  case ExprKind::KIND:                                                         \
+    ++num##KIND##Exprs;                                                        \
+    break;
+#include "Sora/AST/ExprNodes.def"
+    }
+    return {Action::Continue, expr};
+  }
+
+  Action walkToPatternPre(Pattern *pattern) override {
+    switch (pattern->getKind()) {
+#define PATTERN(KIND, PARENT)                                                  \
+  case PatternKind::KIND:                                                      \
+    ++num##KIND##Patterns;                                                     \
+    break;
+#include "Sora/AST/PatternNodes.def"
+    }
+    return Action::Continue;
+  }
+
+  Action walkToStmtPre(Stmt *stmt) override {
+    switch (stmt->getKind()) {
+#define STMT(KIND, PARENT)                                                     \
+  case StmtKind::KIND:                                                         \
+    ++num##KIND##Stmts;                                                        \
+    break;
+#include "Sora/AST/StmtNodes.def"
+    }
+    return Action::Continue;
+  }
+
+  Action walkToTypeReprPre(TypeRepr *tyRepr) override {
+    switch (tyRepr->getKind()) {
+#define TYPEREPR(KIND, PARENT)                                                 \
+  case TypeReprKind::KIND:                                                     \
+    ++num##KIND##TypeReprs;                                                    \
+    break;
+#include "Sora/AST/TypeReprNodes.def"
+    }
+    return Action::Continue;
+  }
+};
+
+/// Walks the AST and collects the number and size of the nodes of each kind.
+/// The size of a node includes its trailing objects.
+struct ASTMemoryUsageCollector : public ASTWalker {
+  MemoryUsage decls[size_t(DeclKind::Last_Decl) + 1];
+  MemoryUsage exprs[size_t(ExprKind::Last_Expr) + 1];
+  MemoryUsage patterns[size_t(PatternKind::Last_Pattern) + 1];
+  MemoryUsage stmts[size_t(StmtKind::Last_Stmt) + 1];
+  MemoryUsage typeReprs[size_t(TypeReprKind::Last_TypeRepr) + 1];
+
+  Action walkToDeclPre(Decl *decl) override {
+    size_t size = 0;
+    switch (decl->getKind()) {
+#define DECL(KIND, PARENT)                                                     \
+  case DeclKind::KIND:                                                         \
+    size = sizeof(KIND##Decl);                                                 \
+    break;
+#include "Sora/AST/DeclNodes.def"
+    }
+    // Count the ParamList with its function.
+    if (auto *func = dyn_cast<FuncDecl>(decl))
+      if (ParamList *params = func->getParamList())
+        size += sizeof(ParamList) +
+                (params->getNumParams() * sizeof(ParamDecl *));
+    decls[size_t(decl->getKind())].add(size);
+    return Action::Continue;
+  }
+
+  std::pair<Action, Expr *> walkToExprPre(Expr *expr) override {
+    size_t size = 0;
+    switch (expr->getKind()) {
+#define EXPR(KIND, PARENT)                                                     \
+  case ExprKind::KIND:                                                         \
+    size = sizeof(KIND##Expr);                                                 \
+    break;
+#include "Sora/AST/ExprNodes.def"
+    }
+    if (auto *tuple = dyn_cast<TupleExpr>(expr))
+      size += tuple->getNumElements() * sizeof(Expr *);
+    else if (auto *call = dyn_cast<CallExpr>(expr))
+      size += call->getNumArgs() * sizeof(Expr *);
+    exprs[size_t(expr->getKind())].add(size);
+    return {Action::Continue, expr};
+  }
+
+  Action walkToPatternPre(Pattern *pattern) override {
+    size_t size = 0;
+    switch (pattern->getKind()) {
+#define PATTERN(KIND, PARENT)                                                  \
+  case PatternKind::KIND:                                                      \
+    size = sizeof(KIND##Pattern);                                              \
+    break;
+#include "Sora/AST/PatternNodes.def"
+    }
+    if (auto *tuple = dyn_cast<TuplePattern>(pattern))
+      size += tuple->getNumElements() * sizeof(Pattern *);
+    patterns[size_t(pattern->getKind())].add(size);
+    return Action::Continue;
+  }
+
+  Action walkToStmtPre(Stmt *stmt) override {
+    size_t size = 0;
+    switch (stmt->getKind()) {
+#define STMT(KIND, PARENT)                                                     \
+  case StmtKind::KIND:                                                         \
+    size = sizeof(KIND##Stmt);                                                 \
+    break;
+#include "Sora/AST/StmtNodes.def"
+    }
+    if (auto *block = dyn_cast<BlockStmt>(stmt))
+      size += block->getNumElements() * sizeof(BlockStmtElement);
+    stmts[size_t(stmt->getKind())].add(size);
+    return Action::Continue;
+  }
+
+  Action walkToTypeReprPre(TypeRepr *tyRepr) override {
+    size_t size = 0;
+    switch (tyRepr->getKind()) {
+#define TYPEREPR(KIND, PARENT)                                                 \
+  case TypeReprKind::KIND:                                                     \
+    size = sizeof(KIND##TypeRepr);                                             \
+    break;
+#include "Sora/AST/TypeReprNodes.def"
+    }
+    if (auto *tuple = dyn_cast<TupleTypeRepr>(tyRepr))
+      size += tuple->getNumElements() * sizeof(TypeRepr *);
+    typeReprs[size_t(tyRepr->getKind())].add(size);
+    return Action::Continue;
+  }
+};
+
+/// Counts \p scope and its children (without expanding them) in \p usage.
+void collectScopeMemoryUsage(const ASTScope *scope, MemoryUsage &usage) {
+  switch (scope->getKind()) {
+#define SCOPE(KIND)                                                            \
+  case ASTScopeKind::KIND:                                                     \
+    usage.add(sizeof(KIND##Scope));                                            \
+    break;
+#include "Sora/AST/ASTScopeKinds.def"
+  }
+  for (const ASTScope *child : scope->getChildren())
+    collectScopeMemoryUsage(child, usage);
+}
+} // namespace
+
+//===- Entry Points -------------------------------------------------------===//
+
+void sora::collectASTStatistics(SourceFile &sf) {
+  if (!llvm::AreStatisticsEnabled())
+    return;
+  sf.walk(ASTStatisticsCollector());
+}
+
+void sora::printASTMemoryUsage(raw_ostream &out, SourceFile &sf) {
+  auto print = [&](StringRef name, MemoryUsage usage) {
+    usage.print(out, name, /*indent*/ 4);
+  };
+
+  ASTMemoryUsageCollector collector;
+  sf.walk(collector);
+  out << "  AST nodes:\n";
+#define DECL(KIND, PARENT)                                                     \
+  print(#KIND "Decl", collector.decls[size_t(DeclKind::KIND)]);
+#include "Sora/AST/DeclNodes.def"
+#define EXPR(KIND, PARENT)                                                     \
+  print(#KIND "Expr", collector.exprs[size_t(ExprKind::KIND)]);
+#include "Sora/AST/ExprNodes.def"
+#define PATTERN(KIND, PARENT)                                                  \
+  print(#KIND "Pattern", collector.patterns[size_t(PatternKind::KIND)]);
+#include "Sora/AST/PatternNodes.def"
+#define STMT(KIND, PARENT)                                                     \
+  print(#KIND "Stmt", collector.stmts[size_t(StmtKind::KIND)]);
+#include "Sora/AST/StmtNodes.def"
+#define TYPEREPR(KIND, PARENT)                                                 \
+  print(#KIND "TypeRepr", collector.typeReprs[size_t(TypeReprKind::KIND)]);
+#include "Sora/AST/TypeReprNodes.def"
+
+  // Don't build the scope map if it hasn't been built yet.
+  SourceFileScope *scopeMap = sf.getScopeMap(/*canLazilyBuild*/ false);
+  if (!scopeMap)
+    return;
+  out << "  scope map:\n";
+  MemoryUsage scopes;
+  collectScopeMemoryUsage(scopeMap, scopes);
+  print("ASTScope", scopes);
+  MemoryUsage index;
+  index.count = scopeMap->getIntervalIndex().size();
+  index.bytes = index.count * sizeof(SourceFileScope::IntervalIndexEntry);
+  print("IntervalIndexEntry", index);
+}
@@ -12,6 +12,7 @@
 #include "Sora/AST/Types.hpp"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
+#include <algorithm>
 #include <type_traits>
 
 using namespace sora;
@@ -99,21 +100,56 @@ bool DeclRefExpr::isFuncDeclRef() const {
 APInt IntegerLiteralExpr::getValue(bool *overflows) const {
   Type type = getType();
   assert(type && type->is<IntegerType>());
-  IntegerWidth intWidth = type->castTo<IntegerType>()->getWidth();
+  IntegerType *intType = type->castTo<IntegerType>();
+
+  if (valueType == intType) {
+    if (overflows)
+      *overflows = valueOverflows;
+    if (valueBitWidth <= 64)
+      return APInt(valueBitWidth, value.inlineWord);
+    ArrayRef<uint64_t> words(value.words, APInt::getNumWords(valueBitWidth));
+    return APInt(valueBitWidth, words);
+  }
 
   IntegerWidth::Status status;
-  APInt result = intWidth.parse(getString(), /*isNegative*/ false, 0, &status);
+  APInt result =
+      intType->getWidth().parse(getString(), /*isNegative*/ false, 0, &status);
   assert(status != IntegerWidth::Status::Error &&
          "Integer Parsing Error - Ill-formed integer token?");
+
+  // Cache the value. Large values are copied in the ASTContext because APInt
+  // isn't trivially destructible.
+  valueType = intType;
+  valueBitWidth = result.getBitWidth();
+  valueOverflows = (status == IntegerWidth::Status::Overflow);
+  if (result.getBitWidth() <= 64) {
+    value.inlineWord = result.getZExtValue();
+  } else {
+    size_t numWords = result.getNumWords();
+    uint64_t *words = static_cast<uint64_t *>(intType->getASTContext().allocate(
+        numWords * sizeof(uint64_t), alignof(uint64_t)));
+    std::copy_n(result.getRawData(), numWords, words);
+    value.words = words;
+  }
+
   if (overflows)
-    *overflows = (status == IntegerWidth::Status::Overflow);
+    *overflows = valueOverflows;
   return result;
 }
 
 APFloat FloatLiteralExpr::getValue() const {
   Type type = getType();
   assert(type && type->is<FloatType>());
-  return APFloat(type->castTo<FloatType>()->getAPFloatSemantics(), getString());
+  FloatType *floatType = type->castTo<FloatType>();
+  const llvm::fltSemantics &semantics = floatType->getAPFloatSemantics();
+
+  if (valueType == floatType)
+    return APFloat(semantics, APInt(floatType->getWidth(), valueBits));
+
+  APFloat result(semantics, getString());
+  valueType = floatType;
+  valueBits = result.bitcastToAPInt().getZExtValue();
+  return result;
 }
 
 bool TupleElementExpr::isMutableLValue() const {
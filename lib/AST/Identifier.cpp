@@ -11,7 +11,9 @@
 
 using namespace sora;
 
-StringRef Identifier::str() const { return StringRef(value); }
+StringRef Identifier::str() const {
+  return isValid() ? StringRef(value, getHeader()->length) : StringRef();
+}
 
 bool Identifier::operator==(StringRef other) const { return str() == other; }
 
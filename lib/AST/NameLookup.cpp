@@ -11,9 +11,19 @@
 #include "Sora/AST/Decl.hpp"
 #include "Sora/AST/SourceFile.hpp"
 #include "Sora/AST/Stmt.hpp"
+#include "llvm/ADT/Statistic.h"
 
 using namespace sora;
 
+#define DEBUG_TYPE "NameLookup"
+
+ALWAYS_ENABLED_STATISTIC(numValueLookups,
+                         "# of unqualified value lookups performed");
+ALWAYS_ENABLED_STATISTIC(numTypeLookups,
+                         "# of unqualified type lookups performed");
+ALWAYS_ENABLED_STATISTIC(numScopesVisited,
+                         "# of ASTScopes visited during lookups");
+
 //===- ASTScope Lookup Implementation -------------------------------------===//
 
 namespace {
@@ -24,11 +34,17 @@ struct ASTScopeLookup {
                  const UnqualifiedLookupOptions &options)
       : consumerFunc(consumer), ident(ident), options(options) {}
 
+  ~ASTScopeLookup() { numScopesVisited += scopesVisited; }
+
   LookupResultConsumer consumerFunc;
   Identifier ident;
   const UnqualifiedLookupOptions &options;
+  /// The number of scopes visited, added to numScopesVisited once the lookup
+  /// is done.
+  unsigned scopesVisited = 0;
 
   void visit(const ASTScope *scope) {
+    ++scopesVisited;
     bool stop;
     switch (scope->getKind()) {
 #define SCOPE(KIND)                                                            \
@@ -75,12 +91,10 @@ struct ASTScopeLookup {
     if (considerEveryResult())
       return consume(sf.getMembers(), scope);
 
-    // If we can't consider everything, remove everything that can't be
-    // considered.
-    // FIXME: Ideally, the SourceFile should have a dedicated lookup cache &
-    // lookup function.
+    // If we can't consider everything, use the SourceFile's lookup table to
+    // find the candidates, and remove everything that can't be considered.
     SmallVector<ValueDecl *, 4> decls;
-    for (ValueDecl *decl : sf.getMembers())
+    for (ValueDecl *decl : sf.lookup(ident))
       if (shouldConsider(decl))
         decls.push_back(decl);
 
@@ -113,13 +127,13 @@ struct ASTScopeLookup {
   }
 
   bool visitBlockStmt(const BlockStmtScope *scope) {
-    // We only need to search for local func declarations.
-    // FIXME: Can this be made more efficient? e.g. by automatically skipping
-    // BlockStmts known to contain no FuncDecls.
-    // Perhaps it'd be a good idea to add a "hasFuncDecl" flag to BlockStmt
-    // (which would be extended to "hasFuncOrTypeDecl") later.
+    // We only need to search for local func declarations, so skip blocks
+    // that don't contain any.
+    BlockStmt *block = scope->getBlockStmt();
+    if (!block->hasFuncDecl())
+      return false;
     SmallVector<ValueDecl *, 4> decls;
-    for (BlockStmtElement elt : scope->getBlockStmt()->getElements()) {
+    for (BlockStmtElement elt : block->getElements()) {
       Decl *decl = elt.dyn_cast<Decl *>();
       if (!decl)
         continue;
@@ -156,6 +170,10 @@ void ASTScope::lookup(ASTScope::LookupResultConsumer consumer,
 //===- UnqualifiedValueLookup ---------------------------------------------===//
 
 void UnqualifiedValueLookup::lookupImpl(SourceLoc loc, Identifier ident) {
+  // Updating a statistic is an atomic operation, so only do it when someone
+  // is going to look at the count.
+  if (llvm::AreStatisticsEnabled())
+    ++numValueLookups;
   assert(loc && "SourceLoc can't be invalid!");
   assert(sourceFile.contains(loc) && "loc doesn't belong to this file!");
   assert(results.empty() &&
@@ -175,6 +193,8 @@ void UnqualifiedValueLookup::lookupImpl(SourceLoc loc, Identifier ident) {
 //===- UnqualifiedTypeLookup ----------------------------------------------===//
 
 void UnqualifiedTypeLookup::lookupImpl(SourceLoc loc, Identifier ident) {
+  if (llvm::AreStatisticsEnabled())
+    ++numTypeLookups;
   assert(loc && "SourceLoc can't be invalid!");
   assert(sourceFile.contains(loc) && "loc doesn't belong to this file!");
   assert(results.empty() &&
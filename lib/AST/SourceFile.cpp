@@ -23,6 +23,29 @@ SourceFile *SourceFile::create(ASTContext &ctxt, BufferID bufferID,
   return sf;
 }
 
+void SourceFile::addMember(ValueDecl *decl) {
+  members.push_back(decl);
+  // Keep the lookup table up to date if it has already been built.
+  if (hasLookupTable)
+    lookupTable[decl->getIdentifier()].push_back(decl);
+}
+
+ArrayRef<ValueDecl *> SourceFile::lookup(Identifier ident) const {
+  buildLookupTable();
+  auto it = lookupTable.find(ident);
+  if (it == lookupTable.end())
+    return {};
+  return it->second;
+}
+
+void SourceFile::buildLookupTable() const {
+  if (hasLookupTable)
+    return;
+  for (ValueDecl *member : members)
+    lookupTable[member->getIdentifier()].push_back(member);
+  hasLookupTable = true;
+}
+
 bool SourceFile::walk(ASTWalker &walker) {
   for (Decl *decl : members) {
     if (!decl->walk(walker))
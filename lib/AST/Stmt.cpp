@@ -11,6 +11,7 @@
 #include "Sora/AST/Decl.hpp"
 #include "Sora/AST/Expr.hpp"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 
 using namespace sora;
 
@@ -107,10 +108,22 @@ BlockStmt::BlockStmt(SourceLoc lCurlyLoc, ArrayRef<BlockStmtElement> elts,
     : Stmt(StmtKind::Block), lCurlyLoc(lCurlyLoc), rCurlyLoc(rCurlyLoc) {
   bits.BlockStmt.numElements = elts.size();
   assert(getNumElements() == elts.size() && "Bits dropped");
+  bits.BlockStmt.hasFuncDecl = llvm::any_of(elts, isFuncDecl);
   std::uninitialized_copy(elts.begin(), elts.end(),
                           getTrailingObjects<BlockStmtElement>());
 }
 
+bool BlockStmt::isFuncDecl(BlockStmtElement elt) {
+  Decl *decl = elt.dyn_cast<Decl *>();
+  return decl && isa<FuncDecl>(decl);
+}
+
+void BlockStmt::setElement(size_t n, BlockStmtElement elt) {
+  getElements()[n] = elt;
+  if (isFuncDecl(elt))
+    bits.BlockStmt.hasFuncDecl = true;
+}
+
 BlockStmt *BlockStmt::create(ASTContext &ctxt, SourceLoc lCurlyLoc,
                              ArrayRef<BlockStmtElement> elts,
                              SourceLoc rCurlyLoc) {
@@ -13,6 +13,7 @@
 #include "Sora/AST/TypeVisitor.hpp"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <type_traits>
 
 using namespace sora;
@@ -160,16 +161,11 @@ namespace {
 class TypeRebuilder : public TypeVisitor<TypeRebuilder, Type> {
   using Parent = TypeVisitor<TypeRebuilder, Type>;
 
-public:
-  ASTContext &ctxt;
-  const std::function<Type(Type)> rebuilder;
+  /// The result of doIt for the types that have already been visited, so
+  /// subtrees that appear more than once are only rebuilt once.
+  llvm::SmallDenseMap<TypeBase *, Type, 8> cache;
 
-  TypeRebuilder(ASTContext &ctxt, std::function<Type(Type)> rebuilder)
-      : ctxt(ctxt), rebuilder(rebuilder) {}
-
-  /// Calls visit on \p type to visit its children, then rebuilds \p type if
-  /// needed, or returns nullptr if it did not change.
-  Type doIt(Type type) {
+  Type doItImpl(Type type) {
     if (Type visited = visit(type)) {
       // The visit changed, use the rebuilt version of the result if it's
       // non-null, else just return the result of the visit.
@@ -181,6 +177,29 @@ public:
     return rebuilder(type);
   }
 
+public:
+  ASTContext &ctxt;
+  const llvm::function_ref<Type(Type)> rebuilder;
+  const TypeProperties onlyIf;
+
+  TypeRebuilder(ASTContext &ctxt, llvm::function_ref<Type(Type)> rebuilder,
+                TypeProperties onlyIf)
+      : ctxt(ctxt), rebuilder(rebuilder), onlyIf(onlyIf) {}
+
+  /// Calls visit on \p type to visit its children, then rebuilds \p type if
+  /// needed, or returns nullptr if it did not change.
+  Type doIt(Type type) {
+    // Skip types that can't contain anything interesting.
+    if (onlyIf && !(type->getTypeProperties() & onlyIf))
+      return nullptr;
+    auto it = cache.find(type.getPtr());
+    if (it != cache.end())
+      return it->second;
+    Type result = doItImpl(type);
+    cache.insert({type.getPtr(), result});
+    return result;
+  }
+
   // The visit functions call doIt on the element types and rebuild the type if
   // needed. They should not call "rebuilder" or "visit" themselves.
   // "Leaf" types should just return nullptr.
@@ -304,8 +323,10 @@ void *TypeBase::operator new(size_t size, ASTContext &ctxt, ArenaKind allocator,
   return ctxt.allocate(size, align, allocator);
 }
 
-Type TypeBase::rebuildType(std::function<Type(Type)> rebuilder) {
-  if (Type rebuilt = TypeRebuilder(getASTContext(), rebuilder).doIt(this))
+Type TypeBase::rebuildType(llvm::function_ref<Type(Type)> rebuilder,
+                           TypeProperties onlyIf) {
+  if (Type rebuilt =
+          TypeRebuilder(getASTContext(), rebuilder, onlyIf).doIt(this))
     return rebuilt;
   return this;
 }
@@ -313,11 +334,13 @@ Type TypeBase::rebuildType(std::function<Type(Type)> rebuilder) {
 Type TypeBase::rebuildTypeWithoutLValues() {
   if (!hasLValue())
     return this;
-  return rebuildType([&](Type type) -> Type {
-    if (LValueType *lvalue = type->getAs<LValueType>())
-      return lvalue->getObjectType();
-    return nullptr;
-  });
+  return rebuildType(
+      [&](Type type) -> Type {
+        if (LValueType *lvalue = type->getAs<LValueType>())
+          return lvalue->getObjectType();
+        return nullptr;
+      },
+      TypeProperties::hasLValue);
 }
 
 CanType TypeBase::getCanonicalType() {
@@ -325,14 +348,15 @@ CanType TypeBase::getCanonicalType() {
   if (isCanonical())
     /// FIXME: Ideally, there should be no const_cast here.
     return CanType(this);
+  CtxtOrCanType value = getCtxtOrCanType();
   // This type has already computed its canonical version
-  if (TypeBase *canType = ctxtOrCanType.dyn_cast<TypeBase *>())
+  if (TypeBase *canType = value.dyn_cast<TypeBase *>())
     return CanType(canType);
   // This type hasn't calculated its canonical version.
-  assert(ctxtOrCanType.is<ASTContext *>() && "Not TypeBase*/ASTContext*?");
+  assert(value.is<ASTContext *>() && "Not TypeBase*/ASTContext*?");
 
   Type result = nullptr;
-  ASTContext &ctxt = *ctxtOrCanType.get<ASTContext *>();
+  ASTContext &ctxt = *value.get<ASTContext *>();
 
   switch (getKind()) {
   case TypeKind::Integer:
@@ -393,7 +417,10 @@ CanType TypeBase::getCanonicalType() {
   // Cache the canonical type & return
   assert(result && "result is nullptr?");
   assert(result->isCanonical() && "result isn't canonical?");
-  ctxtOrCanType = result.getPtr();
+  // Multiple threads may cache the canonical type of a shared type at once,
+  // but they all store the same uniqued pointer.
+  ctxtOrCanType.store(CtxtOrCanType(result.getPtr()).getOpaqueValue(),
+                      std::memory_order_release);
   return CanType(result);
 }
 
@@ -545,10 +572,11 @@ bool TypeVariableEnvironment::canBind(TypeVariableType *typeVar,
     return false;
 
   CanType canType = binding->getCanonicalType();
-  // Cannot bind a type variable to itself.
+  // Cannot bind a type variable to itself, or to a type variable of its own
+  // equivalence class.
   // FIXME: It'd be great to have a more advanced cycle detection system.
   if (auto *tv = canType->getAs<TypeVariableType>())
-    if (typeVar == tv)
+    if (getRepresentative(tv) == typeVar)
       return false;
 
   switch (typeVar->getTypeVariableKind()) {
@@ -576,7 +604,15 @@ void TypeVariableEnvironment::bind(TypeVariableType *typeVar, Type binding,
   assert(typeVar && "TypeVariable cannot be null!");
   assert(binding && "Binding cannot be null!");
   assert(canBind(typeVar, binding) && "Binding is not allowed!");
+  assert(!typeVar->parent && "TypeVariable is not a representative!");
   typeVar->binding = binding;
+  // If the binding is another type variable, merge the equivalence classes.
+  if (TypeVariableType *tv = binding->getAs<TypeVariableType>()) {
+    TypeVariableType *representative = getRepresentative(tv);
+    typeVar->parent = representative;
+    representative->rank =
+        std::max(representative->rank, typeVar->rank + 1);
+  }
   if (canAdjustKind)
     adjustTypeVariableKind(typeVar);
 }
@@ -585,6 +621,27 @@ bool TypeVariableEnvironment::isBound(TypeVariableType *typeVar) const {
   return !getBinding(typeVar).isNull();
 }
 
+TypeVariableType *
+TypeVariableEnvironment::getRepresentative(TypeVariableType *typeVar) const {
+  assert(typeVar && "TypeVariable must not be null!");
+  TypeVariableType *representative = typeVar;
+  while (TypeVariableType *parent = representative->parent)
+    representative = parent;
+  // Path compression: make every type variable on the path point directly to
+  // the representative.
+  while (typeVar != representative) {
+    TypeVariableType *parent = typeVar->parent;
+    typeVar->parent = representative;
+    typeVar = parent;
+  }
+  return representative;
+}
+
+unsigned TypeVariableEnvironment::getRank(TypeVariableType *typeVar) const {
+  assert(typeVar && "TypeVariable must not be null!");
+  return typeVar->rank;
+}
+
 Type TypeVariableEnvironment::simplify(Type type,
                                        bool *hadUnboundTypeVar) const {
   if (!type->hasTypeVariable())
@@ -596,6 +653,10 @@ Type TypeVariableEnvironment::simplify(Type type,
     if (!tyVar)
       return nullptr;
 
+    // Look through the chain of type variables bindings: the representative
+    // is either unbound or bound to something that isn't a type variable.
+    tyVar = getRepresentative(tyVar);
+
     // Replace the TV by its binding if it's bound.
     if (Type binding = getBinding(tyVar))
       return binding->hasTypeVariable() ? simplify(binding, hadUnboundTypeVar) : binding;
@@ -613,7 +674,7 @@ Type TypeVariableEnvironment::simplify(Type type,
     if (hadUnboundTypeVar)
       *hadUnboundTypeVar = true;
     return ctxt.errorType;
-  });
+  }, TypeProperties::hasTypeVariable);
 
   assert(!simplified->hasTypeVariable() && "Type not fully simplified!");
   return simplified;
@@ -9,30 +9,371 @@
 //===----------------------------------------------------------------------===//
 
 #include "Sora/Common/SourceManager.hpp"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <mutex>
 
 using namespace sora;
 
+//===- SourceAddressSpace -------------------------------------------------===//
+
+namespace {
+/// The address space of SourceLocs.
+///
+/// Every buffer given to a SourceManager is assigned a contiguous range of
+/// offsets, large enough to contain the past-the-end loc of the buffer.
+/// This is global because SourceLocs can be converted back to pointers without
+/// a SourceManager. The range of a buffer is reclaimed when it's removed, so
+/// long-lived processes that create many SourceManagers don't run out of
+/// offsets.
+class SourceAddressSpace {
+public:
+  struct Buffer {
+    /// The beginning of the buffer
+    const char *begin = nullptr;
+    /// The offset of the first byte of the buffer
+    uint32_t base = 0;
+    /// The size of the buffer
+    uint32_t size = 0;
+
+    /// \returns the offset past the past-the-end loc of this buffer.
+    uint32_t getEndOffset() const { return base + size + 1; }
+
+    /// \returns true if \p offset is inside this buffer, or past-the-end.
+    bool containsOffset(uint32_t offset) const {
+      return (offset >= base) && ((offset - base) <= size);
+    }
+  };
+
+private:
+  std::mutex mutex;
+  /// The buffers, sorted by base offset.
+  std::vector<Buffer> buffers;
+  /// The buffers, sorted by address. Buffers that begin at the same address
+  /// are sorted from the least to the most recent.
+  std::vector<Buffer> buffersByAddress;
+  /// Incremented every time a buffer is removed, as its offsets can then be
+  /// reused by another buffer.
+  std::atomic<unsigned> generation{0};
+  /// The first valid offset. 0 is the invalid SourceLoc.
+  static constexpr uint32_t minOffset = 1;
+  /// The offsets at and above this one are reserved for DenseMapInfo.
+  static constexpr uint32_t defaultMaxOffset =
+      std::numeric_limits<uint32_t>::max() - 1;
+  /// The end of the usable offsets. Only lowered by tests.
+  uint32_t maxOffset = defaultMaxOffset;
+
+  /// Finds a free range of \p size offsets.
+  /// \returns the base offset of the range (0 if there is none), and the
+  /// position in \c buffers where a buffer using that range must be inserted.
+  std::pair<std::vector<Buffer>::iterator, uint32_t>
+  findFreeRange(uint64_t size) {
+    // Try after the last buffer first: ranges are only reused once the end of
+    // the address space has been reached.
+    uint32_t base = buffers.empty() ? minOffset : buffers.back().getEndOffset();
+    if ((base <= maxOffset) && (size <= (maxOffset - base)))
+      return {buffers.end(), base};
+    // Else, look for a gap between the buffers.
+    base = minOffset;
+    for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+      uint32_t end = std::min(it->base, maxOffset);
+      if ((base <= end) && (size <= (end - base)))
+        return {it, base};
+      base = it->getEndOffset();
+    }
+    return {buffers.end(), 0};
+  }
+
+public:
+  static SourceAddressSpace &get() {
+    // Never destroyed, so SourceManagers with static storage duration can
+    // still use it.
+    static SourceAddressSpace *instance = new SourceAddressSpace();
+    return *instance;
+  }
+
+  /// Sets the end of the usable offsets to \p offset, or restores the default
+  /// one if \p offset is 0.
+  void setMaxOffset(uint32_t offset) {
+    std::lock_guard<std::mutex> guard(mutex);
+    maxOffset = offset ? std::min(offset, defaultMaxOffset) : defaultMaxOffset;
+  }
+
+  /// Adds a buffer of \p size bytes beginning at \p begin.
+  /// \returns the base offset of the buffer.
+  uint32_t add(const char *begin, size_t size) {
+    std::lock_guard<std::mutex> guard(mutex);
+    // + 1 for the past-the-end loc.
+    auto range = findFreeRange(uint64_t(size) + 1);
+    if (!range.second)
+      llvm::report_fatal_error("too much source code: the SourceLoc address "
+                               "space is exhausted");
+    Buffer buffer{begin, range.second, uint32_t(size)};
+    buffers.insert(range.first, buffer);
+
+    // Insert it after the buffers that begin at the same address.
+    auto it = std::upper_bound(buffersByAddress.begin(), buffersByAddress.end(),
+                               begin,
+                               [&](const char *ptr, const Buffer &other) {
+                                 return ptr < other.begin;
+                               });
+    buffersByAddress.insert(it, buffer);
+    return buffer.base;
+  }
+
+  /// Removes the buffer with base offset \p base.
+  void remove(uint32_t base) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = std::lower_bound(buffers.begin(), buffers.end(), base,
+                               [&](const Buffer &buffer, uint32_t base) {
+                                 return buffer.base < base;
+                               });
+    assert((it != buffers.end()) && (it->base == base) && "unknown buffer");
+    auto range = std::equal_range(buffersByAddress.begin(),
+                                  buffersByAddress.end(), *it,
+                                  [&](const Buffer &lhs, const Buffer &rhs) {
+                                    return lhs.begin < rhs.begin;
+                                  });
+    auto byAddressIt = std::find_if(
+        range.first, range.second,
+        [&](const Buffer &buffer) { return buffer.base == base; });
+    assert((byAddressIt != range.second) && "unknown buffer");
+    buffersByAddress.erase(byAddressIt);
+    buffers.erase(it);
+    generation.fetch_add(1, std::memory_order_release);
+  }
+
+  /// \returns the buffer that contains \p offset
+  Buffer findBuffer(uint32_t offset) {
+    // SourceLocs are generally converted in batches from the same buffer, so
+    // remember the last buffer found by this thread, and the generation at
+    // that time: it's stale if a buffer has been removed since then.
+    static thread_local Buffer lastBuffer;
+    static thread_local unsigned lastGeneration = 0;
+    if ((generation.load(std::memory_order_acquire) == lastGeneration) &&
+        lastBuffer.containsOffset(offset))
+      return lastBuffer;
+
+    std::lock_guard<std::mutex> guard(mutex);
+    // Find the last buffer that begins at or before offset.
+    auto it = std::upper_bound(
+        buffers.begin(), buffers.end(), offset,
+        [&](uint32_t offset, const Buffer &buffer) {
+          return offset < buffer.base;
+        });
+    assert((it != buffers.begin()) && "SourceLoc doesn't belong in any buffer");
+    assert(std::prev(it)->containsOffset(offset) &&
+           "SourceLoc doesn't belong in any buffer");
+    lastGeneration = generation.load(std::memory_order_relaxed);
+    return lastBuffer = *std::prev(it);
+  }
+
+  /// \returns the buffer that contains \p ptr, or a Buffer with a null
+  /// \c begin if no buffer contains it.
+  Buffer findBuffer(const char *ptr) {
+    std::lock_guard<std::mutex> guard(mutex);
+    // Find the last buffer that begins at or before ptr. If there are
+    // duplicates, this is the most recent one.
+    auto it = std::upper_bound(buffersByAddress.begin(),
+                               buffersByAddress.end(), ptr,
+                               [&](const char *ptr, const Buffer &buffer) {
+                                 return ptr < buffer.begin;
+                               });
+    // That buffer may end before ptr while an earlier, larger one (e.g. a
+    // buffer that contains a substring given to another SourceManager)
+    // contains it, so walk back until one does.
+    while (it != buffersByAddress.begin()) {
+      --it;
+      if (ptr <= (it->begin + it->size))
+        return *it;
+    }
+    return Buffer();
+  }
+};
+} // namespace
+
+const char *SourceLoc::getPointer() const {
+  if (isInvalid())
+    return nullptr;
+  auto buffer = SourceAddressSpace::get().findBuffer(value);
+  return buffer.begin + (value - buffer.base);
+}
+
+SourceLoc SourceLoc::fromPointer(const char *ptr) {
+  if (!ptr)
+    return SourceLoc();
+  auto buffer = SourceAddressSpace::get().findBuffer(ptr);
+  if (!buffer.begin)
+    return SourceLoc();
+  return SourceLoc(buffer.base + uint32_t(ptr - buffer.begin));
+}
+
+//===- SourceManager ------------------------------------------------------===//
+
+SourceManager::~SourceManager() {
+  for (auto &table : lineTables)
+    SourceAddressSpace::get().remove(table->beginLoc.value);
+}
+
 size_t SourceManager::getDistanceInBytes(SourceLoc beg, SourceLoc end) const {
   assert(beg && end && "invalid locs!");
-  const char *begPtr = beg.getPointer();
-  const char *endPtr = end.getPointer();
 #ifndef NDEBUG
-  unsigned bufferID = llvmSourceMgr.FindBufferContainingLoc(beg.value);
+  BufferID bufferID = findBufferContainingLoc(beg);
   assert(bufferID && "SourceLoc doesn't belong in any buffer!");
-  auto buff = llvmSourceMgr.getMemoryBuffer(bufferID);
-  assert((endPtr >= buff->getBufferStart()) &&
-         (endPtr <= buff->getBufferEnd()) &&
+  assert((bufferID == findBufferContainingLoc(end)) &&
          "beg & end aren't from the same buffer!");
 #endif
-  assert((endPtr >= begPtr) && "beg > end!");
-  return endPtr - begPtr;
+  assert((end >= beg) && "beg > end!");
+  return end.value - beg.value;
 }
 
 BufferID SourceManager::giveBuffer(std::unique_ptr<llvm::MemoryBuffer> buffer) {
-  unsigned bufferID =
+  StringRef str = buffer->getBuffer();
+  BufferID id =
       llvmSourceMgr.AddNewSourceBuffer(std::move(buffer), llvm::SMLoc());
-  return BufferID(bufferID);
+  assert((id.value == (lineTables.size() + 1)) && "unexpected buffer id");
+  SourceLoc beginLoc(SourceAddressSpace::get().add(str.data(), str.size()));
+  lineTables.push_back(std::make_unique<LineTable>(str, beginLoc));
+  auto it = std::upper_bound(buffersByLoc.begin(), buffersByLoc.end(),
+                             beginLoc, [&](SourceLoc loc, BufferID buffer) {
+                               return loc < getLineTable(buffer).beginLoc;
+                             });
+  buffersByLoc.insert(it, id);
+  return id;
+}
+
+void SourceManager::setSourceLocLimitForTesting(uint32_t maxOffset) {
+  SourceAddressSpace::get().setMaxOffset(maxOffset);
+}
+
+namespace {
+/// A MemoryBuffer backed by a read-only memory mapping of a whole file.
+class MappedFileBuffer final : public llvm::MemoryBuffer {
+  llvm::sys::fs::mapped_file_region region;
+  std::string name;
+
+public:
+  MappedFileBuffer(llvm::sys::fs::mapped_file_region &&region, StringRef name)
+      : region(std::move(region)), name(name.str()) {
+    const char *data = this->region.const_data();
+    init(data, data + this->region.size(), /*RequiresNullTerminator*/ true);
+  }
+
+  StringRef getBufferIdentifier() const override { return name; }
+
+  BufferKind getBufferKind() const override { return MemoryBuffer_MMap; }
+};
+
+/// \returns the content of the file \p fd, which is \p size bytes long. The
+/// file is mapped if it's at least \p mmapThreshold bytes long and if its
+/// last page has some room for the null terminator.
+std::unique_ptr<llvm::MemoryBuffer> loadOpenFile(llvm::sys::fs::file_t fd,
+                                                 StringRef path, uint64_t size,
+                                                 uint64_t mmapThreshold) {
+  uint64_t pageSize = llvm::sys::Process::getPageSizeEstimate();
+  if (size && (size >= mmapThreshold) && (size % pageSize)) {
+    std::error_code error;
+    llvm::sys::fs::mapped_file_region region(
+        fd, llvm::sys::fs::mapped_file_region::readonly, size, 0, error);
+    if (!error)
+      return std::make_unique<MappedFileBuffer>(std::move(region), path);
+    // If the file can't be mapped, just copy it into memory.
+  }
+  // Files are never mapped by getOpenFile when IsVolatile is true.
+  auto result = llvm::MemoryBuffer::getOpenFile(
+      fd, path, size, /*RequiresNullTerminator*/ true, /*IsVolatile*/ true);
+  return result ? std::move(*result) : nullptr;
+}
+} // namespace
+
+BufferID SourceManager::loadFile(StringRef path, uint64_t mmapThreshold) {
+  auto fd = llvm::sys::fs::openNativeFileForRead(path);
+  if (!fd) {
+    llvm::consumeError(fd.takeError());
+    return BufferID();
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+  llvm::sys::fs::file_status status;
+  if (!llvm::sys::fs::status(*fd, status))
+    buffer = loadOpenFile(*fd, path, status.getSize(), mmapThreshold);
+  // The mapping remains valid after the file is closed.
+  llvm::sys::fs::closeFile(*fd);
+
+  return buffer ? giveBuffer(std::move(buffer)) : BufferID();
+}
+
+BufferID SourceManager::findBufferContainingLoc(SourceLoc loc) const {
+  if (loc.isInvalid())
+    return BufferID();
+  // Find the last buffer that begins at or before loc.
+  auto it = std::upper_bound(buffersByLoc.begin(), buffersByLoc.end(), loc,
+                             [&](SourceLoc loc, BufferID buffer) {
+                               return loc < getLineTable(buffer).beginLoc;
+                             });
+  if (it == buffersByLoc.begin())
+    return BufferID();
+  BufferID candidate = *std::prev(it);
+  // Like llvm::SourceMgr, consider that the end of the buffer is part of it.
+  size_t offset = loc.value - getLineTable(candidate).beginLoc.value;
+  return (offset <= getBufferStr(candidate).size()) ? candidate : BufferID();
+}
+
+std::pair<unsigned, unsigned>
+SourceManager::getLineAndColumn(SourceLoc loc, BufferID id) const {
+  assert(loc && "loc cannot be invalid");
+  if (!id)
+    id = findBufferContainingLoc(loc);
+  assert(id && "SourceLoc doesn't belong in any buffer!");
+  const LineTable &table = getLineTable(id);
+  assert((loc >= table.beginLoc) &&
+         ((loc.value - table.beginLoc.value) <= getBufferStr(id).size()) &&
+         "loc doesn't belong to this buffer!");
+  return table.getLineAndColumn(loc.value - table.beginLoc.value);
+}
+
+SourceManager::LineTable::LineTable(StringRef buffer, SourceLoc beginLoc)
+    : begin(buffer.data()), beginLoc(beginLoc) {
+  assert(buffer.size() < std::numeric_limits<unsigned>::max() &&
+         "buffer is too large");
+  // memchr is vectorized by most C libraries, so this is much faster than
+  // checking each character individually.
+  const char *cur = buffer.begin(), *end = buffer.end();
+  while (const void *newline = std::memchr(cur, '\n', end - cur)) {
+    cur = static_cast<const char *>(newline);
+    newlineOffsets.push_back(cur - begin);
+    ++cur;
+  }
+}
+
+std::pair<unsigned, unsigned>
+SourceManager::LineTable::getLineAndColumn(unsigned offset) const {
+  // Line N (0-based) begins after the (N-1)th newline and ends at the Nth
+  // newline (or at the end of the buffer for the last line).
+  auto getLineBegin = [&](unsigned line) -> unsigned {
+    return line ? newlineOffsets[line - 1] + 1 : 0;
+  };
+  auto isOnLine = [&](unsigned line) {
+    return (getLineBegin(line) <= offset) &&
+           ((line == newlineOffsets.size()) || offset <= newlineOffsets[line]);
+  };
+
+  // Relaxed accesses are enough: the cached line is just a hint.
+  unsigned line = lastLine.load(std::memory_order_relaxed);
+  if (!isOnLine(line)) {
+    // The line is the number of newlines that come before the offset.
+    line = std::lower_bound(newlineOffsets.begin(), newlineOffsets.end(),
+                            offset) -
+           newlineOffsets.begin();
+    lastLine.store(line, std::memory_order_relaxed);
+  }
+  return {line + 1, offset - getLineBegin(line) + 1};
 }
 
 StringRef SourceManager::getBufferStr(BufferID id) const {
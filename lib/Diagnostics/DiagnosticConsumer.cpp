@@ -76,3 +76,22 @@ void PrintingDiagnosticConsumer::handle(const SourceManager &srcMgr,
   // Emit the message
   srcMgr.llvmSourceMgr.PrintMessage(out, msg, showColors);
 }
+
+void BufferingDiagnosticConsumer::handle(const SourceManager &,
+                                         const Diagnostic &diagnostic) {
+  StoredDiagnostic stored;
+  stored.message = diagnostic.message.str();
+  stored.kind = diagnostic.kind;
+  stored.loc = diagnostic.loc;
+  stored.ranges.append(diagnostic.ranges.begin(), diagnostic.ranges.end());
+  stored.fixits.append(diagnostic.fixits.begin(), diagnostic.fixits.end());
+  diagnostics.push_back(std::move(stored));
+}
+
+void BufferingDiagnosticConsumer::flush(
+    llvm::function_ref<void(const Diagnostic &)> func) {
+  for (const StoredDiagnostic &stored : diagnostics)
+    func(Diagnostic(stored.message, stored.kind, stored.loc, stored.ranges,
+                    stored.fixits));
+  diagnostics.clear();
+}
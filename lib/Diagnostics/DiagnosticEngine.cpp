@@ -198,6 +198,23 @@ void DiagnosticEngine::emit() {
   activeDiagnostic.reset();
 }
 
+void DiagnosticEngine::replay(const Diagnostic &diagnostic) {
+  assert(!activeDiagnostic.hasValue() && "A diagnostic is already in-flight!");
+
+  if (ignoreAll)
+    return;
+
+  // Promote the diagnostic to an error if needed.
+  Diagnostic diag = diagnostic;
+  if (warningsAreErrors && (diag.kind == DiagnosticKind::Warning))
+    diag.kind = DiagnosticKind::Error;
+
+  // Feed it to the consumer if there's one
+  if (consumer)
+    consumer->handle(srcMgr, diag);
+  actOnDiagnosticEmission(diag.kind);
+}
+
 void DiagnosticEngine::abort() { activeDiagnostic.reset(); }
 
 /// \returns the diagnostic string for \p id, formatted with \p providers
@@ -7,6 +7,7 @@
 
 #include "Sora/Driver/Driver.hpp"
 #include "Sora/AST/ASTScope.hpp"
+#include "Sora/AST/Decl.hpp"
 #include "Sora/AST/SourceFile.hpp"
 #include "Sora/Common/SourceManager.hpp"
 #include "Sora/Diagnostics/DiagnosticEngine.hpp"
@@ -15,13 +16,26 @@
 #include "Sora/Driver/Options.hpp"
 #include "Sora/EntryPoints.hpp"
 #include "Sora/SIR/Dialect.hpp"
+#include "Sora/SIR/Passes.hpp"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Module.h"
 #include "mlir/IR/Verifier.h"
+#include "mlir/Pass/PassManager.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <chrono>
 
 using namespace sora;
 using namespace llvm::opt;
@@ -95,22 +109,58 @@ bool CompilerInstance::handleOptions(InputArgList &argList) {
 
   // Trivial options
   options.printMemUsage = argList.hasArg(opt::OPT_print_mem_usage);
+  options.printFileStats = argList.hasArg(opt::OPT_print_file_stats);
+  options.printTimeReport = argList.hasArg(opt::OPT_time_report);
   options.verifyModeEnabled = argList.hasArg(opt::OPT_verify);
   options.dumpParse = argList.hasArg(opt::OPT_dump_parse);
   options.dumpAST = argList.hasArg(opt::OPT_dump_ast);
 
-  // Output file
-  StringRef outputFileName = "-";
-  if (Arg *arg = argList.getLastArg(opt::OPT_o))
-    outputFileName = arg->getValue();
+  // -stats-json
+  if (Arg *arg = argList.getLastArg(opt::OPT_stats_json)) {
+    options.statsJSONFile = arg->getValue();
+    // Statistics must be enabled before they are first incremented,
+    // otherwise they won't be registered.
+    llvm::EnableStatistics(/*PrintOnExit*/ false);
+  }
 
-  std::error_code outputFileError;
-  outputFile = std::make_unique<llvm::ToolOutputFile>(
-      outputFileName, outputFileError, llvm::sys::fs::F_None);
+  // -mmap-threshold
+  if (Arg *arg = argList.getLastArg(opt::OPT_mmap_threshold)) {
+    StringRef value = arg->getValue();
+    if (value.getAsInteger(10, options.mmapThreshold)) {
+      success = false;
+      diagnose(diag::unknown_argv_for, value, arg->getSpelling());
+    }
+  }
 
-  if (outputFileError) {
-    success = false;
-    diagnose(diag::cannot_open_output_file, outputFileName);
+  // -j
+  if (Arg *arg = argList.getLastArg(opt::OPT_j)) {
+    StringRef value = arg->getValue();
+    if (value.getAsInteger(10, options.numThreads) || !options.numThreads) {
+      success = false;
+      diagnose(diag::unknown_argv_for, value, arg->getSpelling());
+    } else {
+      // MLIR runs the function passes using LLVM's parallel algorithms, whose
+      // thread pool is created on first use with this strategy.
+      llvm::parallel::strategy = llvm::hardware_concurrency(options.numThreads);
+    }
+  }
+
+  // -sema-threads=
+  if (Arg *arg = argList.getLastArg(opt::OPT_sema_threads)) {
+    StringRef value = arg->getValue();
+    if (value.getAsInteger(10, options.semaThreads) || !options.semaThreads) {
+      success = false;
+      diagnose(diag::unknown_argv_for, value, arg->getSpelling());
+    }
+  }
+
+  // -O
+  if (Arg *arg = argList.getLastArg(opt::OPT_O)) {
+    StringRef value = arg->getValue();
+    if (value.getAsInteger(10, options.optLevel) || (options.optLevel > 2)) {
+      success = false;
+      diagnose(diag::unknown_argv_for, value, arg->getSpelling());
+    }
   }
 
   // Debug information: process g0 after g, as g0 has precedence over g.
@@ -136,12 +186,48 @@ bool CompilerInstance::handleOptions(InputArgList &argList) {
   if (argList.hasArg(opt::OPT_sema_only))
     setStopAfterStep(Step::Sema);
 
+  // -c and -emit-llvm: handled before the -emit-sir* options, so those take
+  // precedence.
+  if (argList.hasArg(opt::OPT_c))
+    options.desiredOutput = CompilerOutputType::ObjectFile;
+  if (argList.hasArg(opt::OPT_emit_llvm))
+    options.desiredOutput = CompilerOutputType::LLVMModule;
+
+  // -emit-sir
+  if (argList.hasArg(opt::OPT_emit_sir)) {
+    options.desiredOutput = CompilerOutputType::MLIRModule;
+    setStopAfterStep(Step::SIRTransform);
+  }
+
   // -emit-sirgen
   if (Arg *arg = argList.getLastArg(opt::OPT_emit_sirgen)) {
     options.desiredOutput = CompilerOutputType::MLIRModule;
     setStopAfterStep(Step::SIRGen);
   }
 
+  // Output file: handled last, as its default depends on the desired output.
+  llvm::SmallString<128> outputFileName("-");
+  if (Arg *arg = argList.getLastArg(opt::OPT_o))
+    outputFileName = arg->getValue();
+  else if (options.desiredOutput == CompilerOutputType::ObjectFile) {
+    // Object files are written to the current directory by default, and are
+    // named after the first input file.
+    auto inputs = argList.filtered(opt::OPT_INPUT);
+    if (inputs.begin() != inputs.end()) {
+      outputFileName = llvm::sys::path::filename((*inputs.begin())->getValue());
+      llvm::sys::path::replace_extension(outputFileName, "o");
+    }
+  }
+
+  std::error_code outputFileError;
+  outputFile = std::make_unique<llvm::ToolOutputFile>(
+      outputFileName, outputFileError, llvm::sys::fs::F_None);
+
+  if (outputFileError) {
+    success = false;
+    diagnose(diag::cannot_open_output_file, outputFileName);
+  }
+
   return success;
 }
 
@@ -178,6 +264,13 @@ void CompilerInstance::dump(raw_ostream &out) const {
   DUMP_BOOL(options.dumpAST);
   DUMP_BOOL(options.verifyModeEnabled);
   DUMP_BOOL(options.printMemUsage);
+  DUMP_BOOL(options.printFileStats);
+  DUMP_BOOL(options.printTimeReport);
+  out << "options.statsJSONFile: " << options.statsJSONFile << '\n';
+  out << "options.numThreads: " << options.numThreads << '\n';
+  out << "options.semaThreads: " << options.semaThreads << '\n';
+  out << "options.optLevel: " << options.optLevel << '\n';
+  out << "options.mmapThreshold: " << options.mmapThreshold << '\n';
   out << "options.scopeMapPrintingMode: ";
   switch (options.scopeMapPrintingMode) {
   case ScopeMapPrintingMode::None:
@@ -213,6 +306,12 @@ void CompilerInstance::dump(raw_ostream &out) const {
   case CompilerOutputType::MLIRModule:
     out << "MLIRModule\n";
     break;
+  case CompilerOutputType::LLVMModule:
+    out << "LLVMModule\n";
+    break;
+  case CompilerOutputType::ObjectFile:
+    out << "ObjectFile\n";
+    break;
   case CompilerOutputType::Executable:
     out << "Executable\n";
     break;
@@ -230,9 +329,8 @@ BufferID CompilerInstance::loadFile(StringRef filepath) {
   llvm::sys::path::native(canonicalPath, llvm::sys::path::Style::posix);
   llvm::sys::path::remove_dots(canonicalPath, /* remove_dot_dot */ true,
                                llvm::sys::path::Style::posix);
-  if (auto result = llvm::MemoryBuffer::getFile(canonicalPath.str())) {
-    auto buffer = srcMgr.giveBuffer(std::move(*result));
-    assert(buffer && "invalid buffer id returned by giveBuffer");
+  if (BufferID buffer =
+          srcMgr.loadFile(canonicalPath.str(), options.mmapThreshold)) {
     inputBuffers.push_back(buffer);
     return buffer;
   }
@@ -251,11 +349,6 @@ bool CompilerInstance::run() {
       diagnose(diag::no_input_files);
     return false;
   }
-  // Currently, we only accept a single input file.
-  if (inputBuffers.size() != 1) {
-    diagnose(diag::only_one_file_accepted);
-    return false;
-  }
 
   // In verify mode, install the Diagnostic Verifier
   DiagnosticVerifier *verifier = installDiagnosticVerifierIfNeeded();
@@ -279,6 +372,12 @@ bool CompilerInstance::run() {
   // Helper function to finish processing. Returns true on success, false on
   // failure.
   auto finish = [&]() {
+    if (options.printFileStats)
+      printFileStatistics();
+    if (!options.statsJSONFile.empty())
+      success &= writeStatisticsJSON();
+    // Destroying the timers prints the time report.
+    stepTimers.reset();
     // If the compilation process was "truly" successful, keep the output file.
     // Don't keep it if compilation failed but the verifier succeeded.
     if (success)
@@ -287,37 +386,56 @@ bool CompilerInstance::run() {
     return verifier ? verifier->finish() : success;
   };
 
-  // Create the ASTContext
-  createASTContext();
-  assert(astContext && "no ASTContext?");
+  if (options.printTimeReport)
+    stepTimers = std::make_unique<StepTimers>();
 
-  // Create the source file
-  SourceFile &sf = createSourceFile(inputBuffers[0]);
+  // Create the source files
+  createInputFiles();
 
   // Perform Parsing
-  success = doParsing(sf);
+  success = doParsing();
   if (isDone(Step::Parsing)) {
-    dumpScopeMaps(dump_os, sf);
+    for (auto &file : inputFiles)
+      dumpScopeMaps(dump_os, *file->sourceFile);
     return finish();
   }
 
   // Perform Semantic Analysis
-  success = doSema(sf);
-  dumpScopeMaps(dump_os, sf);
+  success = doSema();
+  for (auto &file : inputFiles)
+    dumpScopeMaps(dump_os, *file->sourceFile);
   if (isDone(Step::Sema))
     return finish();
 
-  // Perform SIRGen
+  // Perform SIRGen. Every file is emitted in the same module, which is named
+  // after the first input file.
   mlir::MLIRContext mlirCtxt;
-  mlir::ModuleOp mlirModule = createMLIRModule(mlirCtxt, sf);
-  success = doSIRGen(mlirCtxt, mlirModule, sf);
+  mlir::ModuleOp mlirModule =
+      createMLIRModule(mlirCtxt, *inputFiles.front()->sourceFile);
+  success = doSIRGen(mlirCtxt, mlirModule);
   if (isDone(Step::SIRGen)) {
     if (success && options.desiredOutput == CompilerOutputType::MLIRModule)
       emitMLIRModule(mlirModule);
     return finish();
   }
 
-  // TODO: Other steps
+  // Perform the SIR transformations.
+  success = doSIRTransform(mlirCtxt, mlirModule);
+  if (isDone(Step::SIRTransform)) {
+    if (success && options.desiredOutput == CompilerOutputType::MLIRModule)
+      emitMLIRModule(mlirModule);
+    return finish();
+  }
+
+  // Linking isn't supported, so an executable can't be emitted.
+  if (options.desiredOutput == CompilerOutputType::Executable) {
+    diagnose(diag::linking_not_supported);
+    success = false;
+    return finish();
+  }
+
+  // Perform LLVMGen, which emits the LLVM IR or the object file.
+  success = doLLVMGen(mlirCtxt, mlirModule);
   return finish();
 }
 
@@ -335,9 +453,38 @@ DiagnosticVerifier *CompilerInstance::installDiagnosticVerifierIfNeeded() {
   return ptr;
 }
 
-SourceFile &CompilerInstance::createSourceFile(BufferID buffer) {
-  assert(astContext && "No ASTContext?");
-  return *SourceFile::create(*astContext, buffer, nullptr);
+void CompilerInstance::createInputFiles() {
+  assert(inputFiles.empty() && "input files already created");
+  for (BufferID buffer : inputBuffers)
+    inputFiles.push_back(std::make_unique<InputFile>(srcMgr, buffer));
+}
+
+unsigned CompilerInstance::getNumThreads() const {
+  unsigned numThreads = options.numThreads;
+  if (!numThreads)
+    numThreads = llvm::hardware_concurrency().compute_thread_count();
+  return std::min<size_t>(numThreads, inputFiles.size());
+}
+
+void CompilerInstance::forEachInputFile(
+    llvm::function_ref<void(InputFile &)> func) {
+  unsigned numThreads = getNumThreads();
+  if (numThreads <= 1) {
+    for (auto &file : inputFiles)
+      func(*file);
+    return;
+  }
+
+  // Each InputFile has its own ASTContext and DiagnosticEngine, so they can be
+  // processed concurrently. The SourceManager is shared, but it's only read
+  // from (the only mutable state that may be touched, the line number cache
+  // of llvm::SourceMgr, exists per buffer).
+  llvm::ThreadPool threadPool(llvm::hardware_concurrency(numThreads));
+  for (auto &file : inputFiles) {
+    InputFile *inputFile = file.get();
+    threadPool.async([&func, inputFile]() { func(*inputFile); });
+  }
+  threadPool.wait();
 }
 
 void CompilerInstance::dumpScopeMaps(raw_ostream &out, SourceFile &file) {
@@ -354,13 +501,12 @@ void CompilerInstance::dumpScopeMaps(raw_ostream &out, SourceFile &file) {
   scopeMap->dump(out);
 }
 
-void CompilerInstance::createASTContext() {
-  if (!astContext)
-    astContext = ASTContext::create(srcMgr, diagEng);
-}
-
-void CompilerInstance::printASTContextMemoryUsage(Step step) const {
-  dump_os << "ASTContext memory usage after ";
+void CompilerInstance::printASTContextMemoryUsage(
+    Step step, const InputFile &file) const {
+  dump_os << "ASTContext memory usage ";
+  if (inputFiles.size() > 1)
+    dump_os << "of '" << srcMgr.getBufferName(file.buffer) << "' ";
+  dump_os << "after ";
   switch (step) {
   case Step::Parsing:
     dump_os << "parsing";
@@ -379,55 +525,174 @@ void CompilerInstance::printASTContextMemoryUsage(Step step) const {
     break;
   }
   dump_os << ": ";
-  llvm::write_integer(dump_os, astContext->getTotalMemoryUsed(), 0,
+  llvm::write_integer(dump_os, file.astContext->getTotalMemoryUsed(), 0,
                       llvm::IntegerStyle::Number);
   dump_os << " bytes\n";
+  file.astContext->printMemoryUsage(dump_os);
+  printASTMemoryUsage(dump_os, *file.sourceFile);
 }
 
-bool CompilerInstance::doParsing(SourceFile &file) {
-  parseSourceFile(file);
-  if (options.dumpParse)
-    file.dump(dump_os);
-  if (options.printMemUsage)
-    printASTContextMemoryUsage(Step::Parsing);
+void CompilerInstance::printFileStatistics() const {
+  auto printTime = [&](StringRef name, double seconds) {
+    dump_os << "  " << name << ": "
+            << llvm::format("%.3f", seconds * 1000.0) << "ms\n";
+  };
 
-  bool success = !diagEng.hadAnyError();
-  if (success)
-    verify(file, /*isChecked*/ false);
+  for (auto &file : inputFiles) {
+    dump_os << "statistics of '" << srcMgr.getBufferName(file->buffer)
+            << "':\n";
+    printTime("parsing", file->parsingTime);
+    printTime("semantic analysis", file->semaTime);
+    printTime("sora ir generation", file->sirGenTime);
+    dump_os << "  peak ASTContext memory usage: ";
+    llvm::write_integer(dump_os, file->peakMemoryUsage, 0,
+                        llvm::IntegerStyle::Number);
+    dump_os << " bytes\n";
+  }
+  dump_os << "processed " << inputFiles.size() << " file(s) using "
+          << getNumThreads() << " thread(s)\n";
+}
+
+bool CompilerInstance::writeStatisticsJSON() {
+  for (auto &file : inputFiles)
+    collectASTStatistics(*file->sourceFile);
+
+  std::error_code error;
+  llvm::raw_fd_ostream out(options.statsJSONFile, error,
+                           llvm::sys::fs::OF_Text);
+  if (error) {
+    diagnose(diag::cannot_open_output_file, options.statsJSONFile);
+    return false;
+  }
+  // This also prints the timers, so the time report (if enabled) is included
+  // as well.
+  llvm::PrintStatisticsJSON(out);
+  return true;
+}
+
+bool CompilerInstance::checkForFunctionsDefinedInMultipleFiles() {
+  // Each file has its own ASTContext, so identifiers can't be compared by
+  // pointer. Compare their strings instead.
+  llvm::StringMap<const InputFile *> definitions;
+  bool success = true;
+  for (auto &file : inputFiles) {
+    for (ValueDecl *decl : file->sourceFile->getMembers()) {
+      if (decl->isIllegalRedeclaration())
+        continue;
+      StringRef name = decl->getIdentifier().str();
+      auto result = definitions.insert({name, file.get()});
+      if (result.second)
+        continue;
+      diagEng.diagnose(decl->getIdentifierLoc(),
+                       diag::func_already_defined_in_other_file, name,
+                       srcMgr.getBufferName(result.first->second->buffer));
+      success = false;
+    }
+  }
   return success;
 }
 
-bool CompilerInstance::doSema(SourceFile &file) {
-  performSema(file);
+/// Calls \p func and \returns the time it took to complete, in seconds.
+static double timeCall(llvm::function_ref<void()> func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
 
-  size_t memUsageBefore = 0;
-  if (options.printMemUsage) {
-    printASTContextMemoryUsage(Step::Sema);
-    memUsageBefore = astContext->getTotalMemoryUsed();
+bool CompilerInstance::doParsing() {
+  {
+    llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::parsing));
+    forEachInputFile([&](InputFile &file) {
+      file.parsingTime =
+          timeCall([&]() { parseSourceFile(*file.sourceFile); });
+      file.updatePeakMemoryUsage();
+    });
   }
 
-  astContext->freeUnresolvedExprs();
+  // Everything below is done sequentially, in the order of the input files, so
+  // the output is deterministic.
+  bool success = true;
+  for (auto &file : inputFiles) {
+    file->replayDiagnostics(diagEng);
+    if (options.dumpParse)
+      file->sourceFile->dump(dump_os);
+    if (options.printMemUsage)
+      printASTContextMemoryUsage(Step::Parsing, *file);
+
+    bool fileSuccess = !file->diagEng.hadAnyError();
+    if (fileSuccess) {
+      llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::astVerification));
+      verify(*file->sourceFile, /*isChecked*/ false);
+    }
+    success &= fileSuccess;
+  }
+  return success;
+}
 
-  if (options.printMemUsage) {
-    size_t diff = memUsageBefore - astContext->getTotalMemoryUsed();
-    dump_os << "  ";
-    llvm::write_integer(dump_os, diff, 0, llvm::IntegerStyle::Number);
-    dump_os << " bytes of memory recovered by freeing Unresolved expressions\n";
+bool CompilerInstance::doSema() {
+  {
+    llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::sema));
+    forEachInputFile([&](InputFile &file) {
+      file.semaTime = timeCall([&]() {
+        performSema(*file.sourceFile, options.semaThreads);
+      });
+      file.updatePeakMemoryUsage();
+    });
   }
 
-  if (options.dumpAST)
-    file.dump(dump_os);
+  bool success = true;
+  for (auto &file : inputFiles) {
+    file->replayDiagnostics(diagEng);
+
+    ASTContext &astContext = *file->astContext;
+    size_t memUsageBefore = 0;
+    if (options.printMemUsage) {
+      printASTContextMemoryUsage(Step::Sema, *file);
+      memUsageBefore = astContext.getTotalMemoryUsed();
+    }
+
+    astContext.freeUnresolvedExprs();
 
-  bool success = !diagEng.hadAnyError();
-  if (success)
-    verify(file, /*isChecked*/ true);
+    if (options.printMemUsage) {
+      size_t diff = memUsageBefore - astContext.getTotalMemoryUsed();
+      dump_os << "  ";
+      llvm::write_integer(dump_os, diff, 0, llvm::IntegerStyle::Number);
+      dump_os
+          << " bytes of memory recovered by freeing Unresolved expressions\n";
+    }
+
+    if (options.dumpAST)
+      file->sourceFile->dump(dump_os);
+
+    bool fileSuccess = !file->diagEng.hadAnyError();
+    if (fileSuccess) {
+      llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::astVerification));
+      verify(*file->sourceFile, /*isChecked*/ true);
+    }
+    success &= fileSuccess;
+  }
+
+  if (success && (inputFiles.size() > 1))
+    success = checkForFunctionsDefinedInMultipleFiles();
   return success;
 }
 
 bool CompilerInstance::doSIRGen(mlir::MLIRContext &mlirContext,
-                                mlir::ModuleOp &mlirModule, SourceFile &file) {
-  performSIRGen(mlirContext, mlirModule, file, options.genDebugInfo);
+                                mlir::ModuleOp &mlirModule) {
+  {
+    llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::sirGen));
+    for (auto &file : inputFiles) {
+      file->sirGenTime = timeCall([&]() {
+        performSIRGen(mlirContext, mlirModule, *file->sourceFile,
+                      options.genDebugInfo);
+      });
+      file->replayDiagnostics(diagEng);
+    }
+  }
 #ifndef NDEBUG
+  llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::sirVerification));
   if (mlir::failed(mlir::verify(mlirModule.getOperation()))) {
     diagnose(diag::sirgen_verification_failure);
     return false;
@@ -436,8 +701,115 @@ bool CompilerInstance::doSIRGen(mlir::MLIRContext &mlirContext,
   return !diagEng.hadAnyError();
 }
 
+bool CompilerInstance::doSIRTransform(mlir::MLIRContext &mlirContext,
+                                      mlir::ModuleOp &mlirModule) {
+  llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::sirTransform));
+  // Function passes are run concurrently unless we're limited to one thread.
+  if (options.numThreads == 1)
+    mlirContext.disableMultithreading();
+  mlir::PassManager passManager(&mlirContext);
+  sir::buildSIRPassPipeline(passManager, options.optLevel);
+  // With -time-report, also report the time spent in each pass.
+  if (options.printTimeReport)
+    passManager.enableTiming();
+  if (mlir::failed(passManager.run(mlirModule))) {
+    diagnose(diag::sir_transform_failure);
+    return false;
+  }
+  return !diagEng.hadAnyError();
+}
+
+bool CompilerInstance::doLLVMGen(mlir::MLIRContext &mlirContext,
+                                 mlir::ModuleOp &mlirModule) {
+  std::string error;
+  std::unique_ptr<llvm::TargetMachine> targetMachine =
+      createHostTargetMachine(options.optLevel, error);
+  if (!targetMachine) {
+    diagnose(diag::cannot_create_target_machine, error);
+    return false;
+  }
+
+  std::unique_ptr<llvm::Module> llvmModule;
+  {
+    llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::llvmGen));
+    llvmModule = performLLVMGen(mlirContext, mlirModule, *targetMachine);
+  }
+  if (!llvmModule) {
+    diagnose(diag::llvmgen_failure);
+    return false;
+  }
+
+  {
+    llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::llvmOptimization));
+    performLLVMOptimizations(*llvmModule, options.optLevel, *targetMachine);
+  }
+
+  switch (options.desiredOutput) {
+  case CompilerOutputType::LLVMModule: {
+    llvm::TimeRegion timeRegion(
+        getStepTimer(&StepTimers::llvmModuleEmission));
+    llvmModule->print(outputFile->os(), nullptr);
+    return true;
+  }
+  case CompilerOutputType::ObjectFile: {
+    llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::objectEmission));
+    if (!emitObjectFile(*llvmModule, *targetMachine, outputFile->os())) {
+      diagnose(diag::object_emission_failure);
+      return false;
+    }
+    return true;
+  }
+  case CompilerOutputType::MLIRModule:
+  case CompilerOutputType::Executable:
+    llvm_unreachable("LLVMGen doesn't emit this output");
+  }
+  llvm_unreachable("Unknown CompilerOutputType");
+}
+
 void CompilerInstance::emitMLIRModule(mlir::ModuleOp &mlirModule) {
+  llvm::TimeRegion timeRegion(getStepTimer(&StepTimers::mlirModuleEmission));
   mlir::OpPrintingFlags flags;
   flags.enableDebugInfo();
   mlirModule.print(outputFile->os(), flags);
-}
\ No newline at end of file
+}
+
+//===- CompilerInstance::StepTimers ---------------------------------------===//
+
+CompilerInstance::StepTimers::StepTimers()
+    : group("sorac", "Sora Compiler Time Report"),
+      parsing("parsing", "Parsing", group),
+      sema("sema", "Semantic Analysis", group),
+      astVerification("ast-verification", "AST Verification", group),
+      sirGen("sirgen", "Sora IR Generation", group),
+      sirVerification("sir-verification", "Sora IR Verification", group),
+      sirTransform("sir-transform", "Sora IR Transformations", group),
+      mlirModuleEmission("mlir-module-emission", "MLIR Module Emission",
+                         group),
+      llvmGen("llvmgen", "LLVM IR Generation", group),
+      llvmOptimization("llvm-optimization", "LLVM IR Optimization", group),
+      llvmModuleEmission("llvm-module-emission", "LLVM Module Emission",
+                         group),
+      objectEmission("object-emission", "Object File Emission", group) {}
+
+//===- CompilerInstance::InputFile ----------------------------------------===//
+
+CompilerInstance::InputFile::InputFile(const SourceManager &srcMgr,
+                                       BufferID buffer)
+    : buffer(buffer), diagEng(srcMgr) {
+  auto consumer = std::make_unique<BufferingDiagnosticConsumer>();
+  diagBuffer = consumer.get();
+  diagEng.setConsumer(std::move(consumer));
+  astContext = ASTContext::create(srcMgr, diagEng);
+  sourceFile = SourceFile::create(*astContext, buffer, nullptr);
+}
+
+void CompilerInstance::InputFile::updatePeakMemoryUsage() {
+  peakMemoryUsage =
+      std::max(peakMemoryUsage, astContext->getTotalMemoryUsed());
+}
+
+void CompilerInstance::InputFile::replayDiagnostics(
+    DiagnosticEngine &target) {
+  diagBuffer->flush(
+      [&](const Diagnostic &diagnostic) { target.replay(diagnostic); });
+}
@@ -0,0 +1,112 @@
+//===--- LLVMGen.cpp - LLVM IR Generation -----------------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+
+#include "Sora/Common/LLVM.hpp"
+#include "Sora/EntryPoints.hpp"
+#include "Sora/SIR/Passes.hpp"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Target/LLVMIR.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+using namespace sora;
+
+//===- Entry Points -------------------------------------------------------===//
+
+std::unique_ptr<llvm::TargetMachine>
+sora::createHostTargetMachine(unsigned optLevel, std::string &error) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  std::string triple = llvm::sys::getDefaultTargetTriple();
+  const llvm::Target *target =
+      llvm::TargetRegistry::lookupTarget(triple, error);
+  if (!target)
+    return nullptr;
+
+  llvm::CodeGenOpt::Level codeGenOptLevel =
+      (optLevel == 0) ? llvm::CodeGenOpt::None : llvm::CodeGenOpt::Default;
+  // Generate position-independent code so the object files can be linked
+  // into position-independent executables.
+  return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+      triple, llvm::sys::getHostCPUName(), /*features*/ "",
+      llvm::TargetOptions(), llvm::Reloc::PIC_, /*codeModel*/ llvm::None,
+      codeGenOptLevel));
+}
+
+std::unique_ptr<llvm::Module>
+sora::performLLVMGen(mlir::MLIRContext &mlirCtxt, mlir::ModuleOp &mlirModule,
+                     llvm::TargetMachine &targetMachine) {
+  mlir::PassManager passManager(&mlirCtxt);
+  passManager.addPass(sir::createLowerToLLVMPass());
+  if (mlir::failed(passManager.run(mlirModule)))
+    return nullptr;
+
+  std::unique_ptr<llvm::Module> llvmModule =
+      mlir::translateModuleToLLVMIR(mlirModule);
+  if (!llvmModule)
+    return nullptr;
+  llvmModule->setTargetTriple(targetMachine.getTargetTriple().str());
+  llvmModule->setDataLayout(targetMachine.createDataLayout());
+  return llvmModule;
+}
+
+void sora::performLLVMOptimizations(llvm::Module &llvmModule,
+                                    unsigned optLevel,
+                                    llvm::TargetMachine &targetMachine) {
+  assert(optLevel <= 2 && "Unknown optimization level");
+  if (optLevel == 0)
+    return;
+
+  llvm::PassBuilder passBuilder(&targetMachine);
+  llvm::LoopAnalysisManager loopAM;
+  llvm::FunctionAnalysisManager functionAM;
+  llvm::CGSCCAnalysisManager cgsccAM;
+  llvm::ModuleAnalysisManager moduleAM;
+  passBuilder.registerModuleAnalyses(moduleAM);
+  passBuilder.registerCGSCCAnalyses(cgsccAM);
+  passBuilder.registerFunctionAnalyses(functionAM);
+  passBuilder.registerLoopAnalyses(loopAM);
+  passBuilder.crossRegisterProxies(loopAM, functionAM, cgsccAM, moduleAM);
+
+  llvm::ModulePassManager modulePM = passBuilder.buildPerModuleDefaultPipeline(
+      (optLevel == 1) ? llvm::PassBuilder::OptimizationLevel::O1
+                      : llvm::PassBuilder::OptimizationLevel::O2);
+  modulePM.run(llvmModule, moduleAM);
+}
+
+bool sora::emitObjectFile(llvm::Module &llvmModule,
+                          llvm::TargetMachine &targetMachine,
+                          llvm::raw_pwrite_stream &out) {
+  // Object file writers seek back into the file, which isn't possible if
+  // we're writing to stdout or to a pipe, so buffer the output in that case.
+  // The buffer is flushed to out when it's destroyed.
+  Optional<llvm::buffer_ostream> buffer;
+  llvm::raw_pwrite_stream *stream = &out;
+  if (!out.supportsSeeking()) {
+    buffer.emplace(out);
+    stream = buffer.getPointer();
+  }
+
+  // Code generation still uses the legacy pass manager.
+  llvm::legacy::PassManager codeGenPM;
+  // addPassesToEmitFile returns true if the file type isn't supported.
+  if (targetMachine.addPassesToEmitFile(codeGenPM, *stream, /*dwoOut*/ nullptr,
+                                        llvm::CGFT_ObjectFile))
+    return false;
+  codeGenPM.run(llvmModule);
+  return true;
+}
@@ -11,12 +11,26 @@
 #include "Sora/Common/SourceManager.hpp"
 #include "Sora/Diagnostics/DiagnosticsLexer.hpp"
 #include "Sora/Lexer/Token.hpp"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/ConvertUTF.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include <cstring>
+
+// SSE2 is always available on x86-64, so it can be used without checking for
+// CPU support at runtime.
+#if defined(__SSE2__) || defined(_M_X64)
+#define SORA_LEXER_USE_SSE2
+#include <emmintrin.h>
+#endif
 
 using namespace sora;
 
+#define DEBUG_TYPE "Lexer"
+
+ALWAYS_ENABLED_STATISTIC(numTokensLexed, "# of tokens lexed");
+
 const char *sora::to_string(TokenKind kind) {
   switch (kind) {
 #define TOKEN(KIND)                                                            \
@@ -41,8 +55,9 @@ void Token::dump(raw_ostream &out) const {
 Lexer::Lexer(const SourceManager &srcMgr, BufferID buffer,
              DiagnosticEngine *diagEng)
     : srcMgr(srcMgr), diagEng(diagEng) {
-  // Init begPtr and endPtr
+  // Init begPtr, begLoc and endPtr
   StringRef str = srcMgr.getBufferStr(buffer);
+  begLoc = srcMgr.getBufferCharSourceRange(buffer).getBegin();
   begPtr = str.data();
   endPtr = (str.data() + str.size());
   // Move curPtr to the beginning of the file
@@ -51,8 +66,11 @@ Lexer::Lexer(const SourceManager &srcMgr, BufferID buffer,
   lexImpl();
 }
 
+Lexer::~Lexer() { numTokensLexed += tokensLexed; }
+
 Token Lexer::lex() {
   auto tok = nextToken;
+  ++tokensLexed;
   // Lex if we haven't reached EOF
   if (tok.isNot(TokenKind::EndOfFile))
     lexImpl();
@@ -80,6 +98,150 @@ bool isTrivia(char ch) {
   // clang-format on
 }
 
+/// \returns a pointer to the first character in [\p cur, \p end) that isn't
+/// trivia, or \p end if there is none. Sets \p sawNewline to true if a '\n'
+/// was skipped.
+const char *skipTrivia(const char *cur, const char *end, bool &sawNewline) {
+#ifdef SORA_LEXER_USE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i newline = _mm_set1_epi8('\n');
+  // '\t', '\n', '\v', '\f' and '\r' are in the [9, 13] range.
+  const __m128i rangeBeg = _mm_set1_epi8(9);
+  const __m128i rangeSize = _mm_set1_epi8(13 - 9);
+  while ((end - cur) >= 16) {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur));
+    // (chars - 9) <= 4, using an unsigned comparison.
+    __m128i offset = _mm_sub_epi8(chars, rangeBeg);
+    __m128i inRange =
+        _mm_cmpeq_epi8(_mm_min_epu8(offset, rangeSize), offset);
+    __m128i trivia = _mm_or_si128(
+        inRange, _mm_or_si128(_mm_cmpeq_epi8(chars, zero),
+                              _mm_cmpeq_epi8(chars, space)));
+    unsigned triviaMask = _mm_movemask_epi8(trivia);
+    unsigned newlineMask = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, newline));
+    if (triviaMask != 0xFFFF) {
+      unsigned firstNonTrivia = llvm::countTrailingZeros(~triviaMask);
+      // Only consider the newlines before the first non-trivia character.
+      sawNewline |= (newlineMask & ((1U << firstNonTrivia) - 1)) != 0;
+      return cur + firstNonTrivia;
+    }
+    sawNewline |= (newlineMask != 0);
+    cur += 16;
+  }
+#endif
+  for (; cur != end && isTrivia(*cur); ++cur)
+    sawNewline |= (*cur == '\n');
+  return cur;
+}
+
+/// \returns a pointer to the first '*' or '\n' in [\p cur, \p end), or \p end
+/// if there is none.
+const char *findStarOrNewline(const char *cur, const char *end) {
+#ifdef SORA_LEXER_USE_SSE2
+  const __m128i star = _mm_set1_epi8('*');
+  const __m128i newline = _mm_set1_epi8('\n');
+  while ((end - cur) >= 16) {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur));
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(chars, star), _mm_cmpeq_epi8(chars, newline)));
+    if (mask)
+      return cur + llvm::countTrailingZeros(mask);
+    cur += 16;
+  }
+#endif
+  for (; cur != end; ++cur)
+    if (*cur == '*' || *cur == '\n')
+      return cur;
+  return end;
+}
+
+//===- Keyword Table ------------------------------------------------------===//
+// The keyword table is an open-addressing hash table generated at compile time
+// from the KEYWORD entries of TokenKinds.def. Collisions are resolved using
+// linear probing, but the hash function is chosen so that the current keywords
+// don't collide: classifying a keyword requires a single string comparison.
+// Other identifiers are compared with every keyword of the run of occupied
+// slots that starts at their hash, which is usually empty or very short.
+//===----------------------------------------------------------------------===//
+
+struct Keyword {
+  const char *text;
+  unsigned length;
+  TokenKind kind;
+};
+
+constexpr Keyword keywords[] = {
+#define KEYWORD(KIND, TEXT) {TEXT, sizeof(TEXT) - 1, TokenKind::KIND},
+#include "Sora/Lexer/TokenKinds.def"
+};
+
+constexpr unsigned numKeywords = sizeof(keywords) / sizeof(Keyword);
+constexpr unsigned keywordTableSize = 64;
+static_assert(numKeywords < keywordTableSize, "keyword table is too small");
+
+constexpr unsigned getMaxKeywordLength() {
+  unsigned result = 0;
+  for (const Keyword &keyword : keywords)
+    result = (keyword.length > result) ? keyword.length : result;
+  return result;
+}
+
+constexpr unsigned maxKeywordLength = getMaxKeywordLength();
+
+/// Hashes a non-empty string of \p length characters starting at \p str.
+constexpr unsigned hashKeyword(const char *str, unsigned length) {
+  unsigned second = (length > 1) ? 1 : 0;
+  return (length + (unsigned char)str[0] + 2 * (unsigned char)str[second] +
+          (unsigned char)str[length - 1]) %
+         keywordTableSize;
+}
+
+struct KeywordTable {
+  /// The index of the keyword in each slot plus one, or 0 for empty slots.
+  uint8_t slots[keywordTableSize];
+};
+
+constexpr KeywordTable buildKeywordTable() {
+  KeywordTable table{};
+  for (unsigned k = 0; k < numKeywords; ++k) {
+    unsigned slot = hashKeyword(keywords[k].text, keywords[k].length);
+    while (table.slots[slot])
+      slot = (slot + 1) % keywordTableSize;
+    table.slots[slot] = k + 1;
+  }
+  return table;
+}
+
+constexpr KeywordTable keywordTable = buildKeywordTable();
+
+/// \returns true if every keyword is in the slot of its hash.
+constexpr bool hasNoKeywordCollisions() {
+  for (unsigned k = 0; k < numKeywords; ++k)
+    if (keywordTable.slots[hashKeyword(keywords[k].text,
+                                       keywords[k].length)] != k + 1)
+      return false;
+  return true;
+}
+
+static_assert(hasNoKeywordCollisions(),
+              "keywords collide in the keyword table, change hashKeyword");
+
+/// \returns the kind of the keyword spelled \p str, or TokenKind::Identifier
+/// if \p str isn't a keyword.
+TokenKind classifyIdentifier(StringRef str) {
+  if (str.empty() || (str.size() > maxKeywordLength))
+    return TokenKind::Identifier;
+  unsigned slot = hashKeyword(str.data(), str.size());
+  while (unsigned index = keywordTable.slots[slot]) {
+    const Keyword &keyword = keywords[index - 1];
+    if (str == StringRef(keyword.text, keyword.length))
+      return keyword.kind;
+    slot = (slot + 1) % keywordTableSize;
+  }
+  return TokenKind::Identifier;
+}
+
 /// \returns true if \p ch is a UTF8 byte
 bool isUTF8(char ch) { return ((unsigned char)ch & 0x80); }
 
@@ -119,7 +281,8 @@ uint32_t advanceUTF8(const char *&cur, const char *end,
 
 Token Lexer::getTokenAtLoc(const SourceManager &srcMgr, SourceLoc loc) {
   Lexer lexer(srcMgr, srcMgr.findBufferContainingLoc(loc), nullptr);
-  const char *ptr = loc.getPointer();
+  const char *ptr =
+      lexer.begPtr + srcMgr.getDistanceInBytes(lexer.begLoc, loc);
   const char *beg = lexer.tokBegPtr;
   // Backtrack until we hit a newline or something that isn't a trivia.
   // That way, when we call lexImpl(), it'll accurately set the
@@ -214,12 +377,7 @@ void Lexer::lexIdentifierBody() {
   while (!isUTF8(*curPtr) &&
          (isValidIdentifierHead(*curPtr) || isdigit(*curPtr)))
     ++curPtr;
-  StringRef tokStr = getTokStr();
-#define KEYWORD(KIND, TEXT)                                                    \
-  if (tokStr == TEXT)                                                          \
-    return pushToken(TokenKind::KIND);
-#include "Sora/Lexer/TokenKinds.def"
-  pushToken(TokenKind::Identifier);
+  pushToken(classifyIdentifier(getTokStr()));
 }
 
 void Lexer::handleLineComment() {
@@ -228,12 +386,14 @@ void Lexer::handleLineComment() {
   // line-comment-item = any character except '\n' or '\r'
   // line-comment = "//" line-comment-item* line-break
   curPtr += 2;
-  while (curPtr != endPtr) {
-    if (*curPtr++ == '\n') {
-      tokenIsAtStartOfLine = true;
-      return;
-    }
+  // memchr is vectorized by most C libraries.
+  const void *newline = std::memchr(curPtr, '\n', endPtr - curPtr);
+  if (!newline) {
+    curPtr = endPtr;
+    return;
   }
+  curPtr = static_cast<const char *>(newline) + 1;
+  tokenIsAtStartOfLine = true;
 }
 
 void Lexer::handleBlockComment() {
@@ -242,12 +402,14 @@ void Lexer::handleBlockComment() {
   // block-comment-item = any character except "*/"
   // block-comment = "/*" block-comment-item* "*/"
   curPtr += 2;
-  char ch;
   while (curPtr != endPtr) {
-    ch = *curPtr++;
+    curPtr = findStarOrNewline(curPtr, endPtr);
+    if (curPtr == endPtr)
+      return;
+    char ch = *curPtr++;
     if (ch == '\n')
       tokenIsAtStartOfLine = true;
-    else if ((ch == '*') && (*curPtr == '/')) {
+    else if (*curPtr == '/') {
       ++curPtr;
       return;
     }
@@ -432,9 +594,10 @@ void Lexer::consumeTrivia() {
   while (curPtr != endPtr) {
     // handle normal trivia
     if (isTrivia(*curPtr)) {
-      if (*curPtr == '\n')
+      bool sawNewline = false;
+      curPtr = skipTrivia(curPtr, endPtr, sawNewline);
+      if (sawNewline)
         tokenIsAtStartOfLine = true;
-      ++curPtr;
     }
     // slash-slash "line" comments
     else if ((*curPtr == '/') && (*(curPtr + 1) == '/'))
@@ -12,6 +12,8 @@
 #include "Sora/SIR/Dialect.hpp"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/StandardTypes.h"
+#include "llvm/ADT/APSInt.h"
 
 using namespace sora;
 using namespace sora::sir;
@@ -21,6 +23,10 @@ using namespace sora::sir;
 mlir::OpFoldResult BitNotOp::fold(ArrayRef<Attribute> operands) {
   mlir::Operation *op = getOperand().getDefiningOp();
 
+  // bitnot(bitnot x) is x.
+  if (auto bitNotSrc = dyn_cast_or_null<BitNotOp>(op))
+    return bitNotSrc.getOperand();
+
   // If the operand is a constant, we can just invert the constant's bits.
   mlir::ConstantOp constantSrc = dyn_cast_or_null<mlir::ConstantOp>(op);
   if (!constantSrc)
@@ -52,4 +58,133 @@ DestructureTupleOp::fold(ArrayRef<mlir::Attribute> operands,
   for (mlir::Value tupleElt : tupleSrc.getOperands())
     results.emplace_back(tupleElt);
   return mlir::success();
-}
\ No newline at end of file
+}
+
+//===- StaticCastOp -------------------------------------------------------===//
+
+/// \returns whether \p type is a pointer or a reference type. Casts between
+/// those types don't change the address.
+static bool isPointerLike(mlir::Type type) {
+  return type.isa<PointerType>() || type.isa<ReferenceType>();
+}
+
+/// Folds the cast of the integer constant \p value to \p toType.
+/// \p isUnsigned is true if \p value is an unsigned integer.
+///
+/// Casts to i1 compare \p value with zero.
+static mlir::Attribute foldIntegerCast(const llvm::APInt &value,
+                                       bool isUnsigned, mlir::Type toType) {
+  if (auto intType = toType.dyn_cast<mlir::IntegerType>()) {
+    unsigned width = intType.getWidth();
+    if (width == 1)
+      return mlir::IntegerAttr::get(toType,
+                                    llvm::APInt(1, !value.isNullValue()));
+    llvm::APInt result =
+        isUnsigned ? value.zextOrTrunc(width) : value.sextOrTrunc(width);
+    return mlir::IntegerAttr::get(toType, result);
+  }
+
+  if (auto floatType = toType.dyn_cast<mlir::FloatType>()) {
+    llvm::APFloat result(floatType.getFloatSemantics());
+    result.convertFromAPInt(value, /*isSigned*/ !isUnsigned,
+                            llvm::APFloat::rmNearestTiesToEven);
+    return mlir::FloatAttr::get(toType, result);
+  }
+
+  return {};
+}
+
+/// Folds the cast of the float constant \p value to \p toType.
+/// \p isUnsigned is true if \p toType is an unsigned integer.
+///
+/// Casts to i1 compare \p value with zero. Conversions to other integers are
+/// only folded when \p value fits in the integer type.
+static mlir::Attribute foldFloatCast(llvm::APFloat value, bool isUnsigned,
+                                     mlir::Type toType) {
+  if (auto floatType = toType.dyn_cast<mlir::FloatType>()) {
+    bool losesInfo = false;
+    value.convert(floatType.getFloatSemantics(),
+                  llvm::APFloat::rmNearestTiesToEven, &losesInfo);
+    return mlir::FloatAttr::get(toType, value);
+  }
+
+  if (auto intType = toType.dyn_cast<mlir::IntegerType>()) {
+    unsigned width = intType.getWidth();
+    if (width == 1)
+      return mlir::IntegerAttr::get(toType, llvm::APInt(1, !value.isZero()));
+    llvm::APSInt result(width, isUnsigned);
+    bool isExact = false;
+    llvm::APFloat::opStatus status =
+        value.convertToInteger(result, llvm::APFloat::rmTowardZero, &isExact);
+    if (status & llvm::APFloat::opInvalidOp)
+      return {};
+    return mlir::IntegerAttr::get(toType, result);
+  }
+
+  return {};
+}
+
+/// \returns true if static_cast(static_cast(x : A to B) : B to A) is always x.
+static bool isRoundTripCast(mlir::Type a, mlir::Type b) {
+  if (isPointerLike(a) && isPointerLike(b))
+    return true;
+  // Extending then truncating an integer gives back the original value,
+  // whether the extension is signed or not. The same goes for floats.
+  if (a.isa<mlir::IntegerType>() && b.isa<mlir::IntegerType>())
+    return b.getIntOrFloatBitWidth() > a.getIntOrFloatBitWidth();
+  if (a.isa<mlir::FloatType>() && b.isa<mlir::FloatType>())
+    return b.getIntOrFloatBitWidth() > a.getIntOrFloatBitWidth();
+  return false;
+}
+
+/// \returns true if static_cast(static_cast(x : A to B) : B to C) is always
+/// static_cast(x : A to C).
+static bool isComposableCast(mlir::Type a, mlir::Type b, mlir::Type c) {
+  if (isPointerLike(a) && isPointerLike(b) && isPointerLike(c))
+    return true;
+  // Truncations compose, but casts to i1 compare with zero.
+  if (a.isa<mlir::IntegerType>() && b.isa<mlir::IntegerType>() &&
+      c.isa<mlir::IntegerType>()) {
+    unsigned aWidth = a.getIntOrFloatBitWidth();
+    unsigned bWidth = b.getIntOrFloatBitWidth();
+    unsigned cWidth = c.getIntOrFloatBitWidth();
+    return (aWidth > bWidth) && (bWidth > cWidth) && (cWidth > 1);
+  }
+  return false;
+}
+
+mlir::OpFoldResult StaticCastOp::fold(ArrayRef<mlir::Attribute> operands) {
+  mlir::Type toType = getType();
+
+  // Casting a value to its own type does nothing.
+  if (getOperand().getType() == toType)
+    return getOperand();
+
+  // Fold casts of constants.
+  if (auto intAttr = operands[0].dyn_cast_or_null<mlir::IntegerAttr>())
+    return foldIntegerCast(intAttr.getValue(), isUnsignedOperand(), toType);
+  if (auto floatAttr = operands[0].dyn_cast_or_null<mlir::FloatAttr>())
+    return foldFloatCast(floatAttr.getValue(), isUnsignedResult(), toType);
+
+  // Fold chains of casts.
+  mlir::Operation *op = getOperand().getDefiningOp();
+  auto castSrc = dyn_cast_or_null<StaticCastOp>(op);
+  if (!castSrc)
+    return {};
+
+  mlir::Value value = castSrc.getOperand();
+  mlir::Type fromType = value.getType();
+  mlir::Type midType = castSrc.getType();
+  if ((fromType == toType) && isRoundTripCast(fromType, midType))
+    return value;
+  if (isComposableCast(fromType, midType, toType)) {
+    // Cast the original value directly (this folds the operation in place).
+    getOperation()->setOperand(0, value);
+    if (castSrc.fromUnsigned())
+      setAttr("fromUnsigned", castSrc.fromUnsignedAttr());
+    else
+      getOperation()->removeAttr("fromUnsigned");
+    return getResult();
+  }
+  return {};
+}
@@ -9,12 +9,14 @@
 
 #include "Sora/Common/LLVM.hpp"
 #include "Sora/SIR/Types.hpp"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/OpDefinition.h"
 #include "mlir/IR/OpImplementation.h"
 #include "mlir/IR/StandardTypes.h"
 #include "mlir/IR/Value.h"
 #include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/InliningUtils.h"
 
 using namespace sora;
 using namespace sora::sir;
@@ -23,6 +25,47 @@ using namespace sora::sir;
 // Dialect
 //===----------------------------------------------------------------------===//
 
+namespace {
+/// Allows SIR operations to be inlined.
+struct SIRInlinerInterface : public mlir::DialectInlinerInterface {
+  using DialectInlinerInterface::DialectInlinerInterface;
+
+  bool isLegalToInline(mlir::Region *dest, mlir::Region *src,
+                       mlir::BlockAndValueMapping &mapping) const override {
+    // sir.block can only contain a single block.
+    if (isa<BlockOp>(dest->getParentOp()))
+      return llvm::hasSingleElement(*src);
+    return true;
+  }
+
+  bool isLegalToInline(mlir::Operation *op, mlir::Region *dest,
+                       mlir::BlockAndValueMapping &mapping) const override {
+    // sir.default_return doesn't have operands, so it can't replace the
+    // results of a call.
+    if (auto defaultReturn = dyn_cast<DefaultReturnOp>(op))
+      return defaultReturn.getFuncOp().getType().getNumResults() == 0;
+    return true;
+  }
+
+  void handleTerminator(mlir::Operation *op,
+                        mlir::Block *newDest) const override {
+    // sir.default_return is the only SIR terminator that can end a function.
+    assert(isa<DefaultReturnOp>(op) && "unexpected terminator");
+    mlir::OpBuilder builder(op);
+    builder.create<mlir::BranchOp>(op->getLoc(), newDest);
+    op->erase();
+  }
+
+  void handleTerminator(mlir::Operation *op,
+                        ArrayRef<mlir::Value> valuesToReplace) const override {
+    // sir.default_return doesn't return anything, so there is nothing to
+    // replace.
+    assert(isa<DefaultReturnOp>(op) && "unexpected terminator");
+    assert(valuesToReplace.empty() && "sir.default_return has no operands");
+  }
+};
+} // namespace
+
 SIRDialect::SIRDialect(mlir::MLIRContext *mlirCtxt)
     : mlir::Dialect("sir", mlirCtxt) {
   addOperations<
@@ -34,14 +77,31 @@ SIRDialect::SIRDialect(mlir::MLIRContext *mlirCtxt)
   addTypes<ReferenceType>();
   addTypes<PointerType>();
   addTypes<VoidType>();
+
+  addInterfaces<SIRInlinerInterface>();
+}
+
+mlir::Operation *SIRDialect::materializeConstant(mlir::OpBuilder &builder,
+                                                 mlir::Attribute value,
+                                                 mlir::Type type,
+                                                 mlir::Location loc) {
+  if (!mlir::ConstantOp::isBuildableWith(value, type))
+    return nullptr;
+  return builder.create<mlir::ConstantOp>(loc, type, value);
 }
 
 //===----------------------------------------------------------------------===//
 // StaticCastOp
 //===----------------------------------------------------------------------===//
 
-/// FIXME: Are there really no invariants to verify?
-static mlir::LogicalResult verify(StaticCastOp op) { return mlir::success(); }
+static mlir::LogicalResult verify(StaticCastOp op) {
+  // The signedness attributes are only meaningful on integers.
+  if (op.fromUnsigned() && !op.getOperand().getType().isa<mlir::IntegerType>())
+    return op.emitOpError("'fromUnsigned' requires an integer operand");
+  if (op.toUnsigned() && !op.getType().isa<mlir::IntegerType>())
+    return op.emitOpError("'toUnsigned' requires an integer result");
+  return mlir::success();
+}
 
 //===----------------------------------------------------------------------===//
 // AllocStackOp
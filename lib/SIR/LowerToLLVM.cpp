@@ -0,0 +1,380 @@
+//===--- LowerToLLVM.cpp - Sora IR to LLVM Dialect Lowering -----*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the "convert-sir-to-llvm" pass, which lowers a module
+// containing SIR and StandardOps operations to the LLVM dialect.
+//
+// SIR types are lowered as follows:
+//   - !sir.pointer<T> and !sir.reference<T> become pointers to T.
+//   - !sir.maybe<T> becomes a struct containing T and an i1 flag.
+//   - !sir.void and tuples become structs (the former being empty).
+//
+//===----------------------------------------------------------------------===//
+
+#include "Sora/SIR/Passes.hpp"
+
+#include "Sora/Common/LLVM.hpp"
+#include "Sora/SIR/Dialect.hpp"
+#include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVM.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/DialectConversion.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace sora;
+using namespace sora::sir;
+
+namespace LLVM = mlir::LLVM;
+
+namespace {
+/// Converts SIR and builtin types to LLVM dialect types.
+class SIRTypeConverter : public mlir::LLVMTypeConverter {
+  /// \returns the LLVM type of \p type, or nullptr if it can't be converted.
+  LLVM::LLVMType convertToLLVMType(mlir::Type type) {
+    return convertType(type).dyn_cast_or_null<LLVM::LLVMType>();
+  }
+
+  /// \returns a pointer to the LLVM type of \p pointeeType, or nullptr if it
+  /// can't be converted.
+  mlir::Type convertPointerLikeType(mlir::Type pointeeType) {
+    if (LLVM::LLVMType llvmPointeeType = convertToLLVMType(pointeeType))
+      return llvmPointeeType.getPointerTo();
+    return {};
+  }
+
+  /// \returns a struct of the LLVM types of \p types, or nullptr if one of
+  /// them can't be converted.
+  mlir::Type convertToStructType(ArrayRef<mlir::Type> types) {
+    SmallVector<LLVM::LLVMType, 4> elts;
+    for (mlir::Type type : types) {
+      LLVM::LLVMType llvmType = convertToLLVMType(type);
+      if (!llvmType)
+        return {};
+      elts.push_back(llvmType);
+    }
+    return LLVM::LLVMType::getStructTy(getDialect(), elts);
+  }
+
+public:
+  SIRTypeConverter(mlir::MLIRContext *mlirCtxt)
+      : LLVMTypeConverter(mlirCtxt) {
+    addConversion([&](PointerType type) {
+      return convertPointerLikeType(type.getPointeeType());
+    });
+    addConversion([&](ReferenceType type) {
+      return convertPointerLikeType(type.getPointeeType());
+    });
+    addConversion([&](MaybeType type) -> mlir::Type {
+      LLVM::LLVMType valueType = convertToLLVMType(type.getValueType());
+      if (!valueType)
+        return {};
+      return LLVM::LLVMType::getStructTy(
+          getDialect(), {valueType, LLVM::LLVMType::getInt1Ty(getDialect())});
+    });
+    addConversion([&](VoidType type) { return convertToStructType({}); });
+    addConversion([&](mlir::TupleType type) {
+      return convertToStructType(type.getTypes());
+    });
+  }
+};
+
+/// Base class of the patterns lowering the SIR operation \p Op to the LLVM
+/// dialect.
+template <typename Op>
+class SIRToLLVMPattern : public mlir::ConvertToLLVMPattern {
+protected:
+  SIRTypeConverter &converter;
+
+  /// Lowers \p op, whose operands have been converted to \p operands.
+  virtual mlir::LogicalResult
+  lower(Op op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const = 0;
+
+public:
+  SIRToLLVMPattern(SIRTypeConverter &converter)
+      : ConvertToLLVMPattern(Op::getOperationName(), &converter.getContext(),
+                             converter),
+        converter(converter) {}
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::Operation *op, ArrayRef<mlir::Value> operands,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    return lower(cast<Op>(op), operands, rewriter);
+  }
+};
+
+struct AllocStackOpLowering : public SIRToLLVMPattern<AllocStackOp> {
+  using SIRToLLVMPattern::SIRToLLVMPattern;
+
+  mlir::LogicalResult
+  lower(AllocStackOp op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const override {
+    mlir::Type type = converter.convertType(op.getType());
+    if (!type)
+      return mlir::failure();
+    mlir::Value one = rewriter.create<LLVM::ConstantOp>(
+        op.getLoc(), LLVM::LLVMType::getInt64Ty(converter.getDialect()),
+        rewriter.getI64IntegerAttr(1));
+    rewriter.replaceOpWithNewOp<LLVM::AllocaOp>(op, type, one,
+                                                /*alignment*/ 0);
+    return mlir::success();
+  }
+};
+
+struct BitNotOpLowering : public SIRToLLVMPattern<BitNotOp> {
+  using SIRToLLVMPattern::SIRToLLVMPattern;
+
+  mlir::LogicalResult
+  lower(BitNotOp op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const override {
+    auto intType = op.getType().dyn_cast<mlir::IntegerType>();
+    if (!intType)
+      return mlir::failure();
+    mlir::Type type = operands[0].getType();
+    // ~x is x ^ -1.
+    mlir::Value allOnes = rewriter.create<LLVM::ConstantOp>(
+        op.getLoc(), type,
+        rewriter.getIntegerAttr(
+            intType, llvm::APInt::getAllOnesValue(intType.getWidth())));
+    rewriter.replaceOpWithNewOp<LLVM::XOrOp>(op, type, operands[0], allOnes);
+    return mlir::success();
+  }
+};
+
+struct CreateTupleOpLowering : public SIRToLLVMPattern<CreateTupleOp> {
+  using SIRToLLVMPattern::SIRToLLVMPattern;
+
+  mlir::LogicalResult
+  lower(CreateTupleOp op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const override {
+    mlir::Type type = converter.convertType(op.getType());
+    if (!type)
+      return mlir::failure();
+    mlir::Location loc = op.getLoc();
+    mlir::Value tuple = rewriter.create<LLVM::UndefOp>(loc, type);
+    for (size_t k = 0; k < operands.size(); ++k)
+      tuple = rewriter.create<LLVM::InsertValueOp>(
+          loc, type, tuple, operands[k], rewriter.getI64ArrayAttr(k));
+    rewriter.replaceOp(op, tuple);
+    return mlir::success();
+  }
+};
+
+struct DestructureTupleOpLowering
+    : public SIRToLLVMPattern<DestructureTupleOp> {
+  using SIRToLLVMPattern::SIRToLLVMPattern;
+
+  mlir::LogicalResult
+  lower(DestructureTupleOp op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const override {
+    SmallVector<mlir::Value, 4> elts;
+    for (auto result : llvm::enumerate(op.getResultTypes())) {
+      mlir::Type type = converter.convertType(result.value());
+      if (!type)
+        return mlir::failure();
+      elts.push_back(rewriter.create<LLVM::ExtractValueOp>(
+          op.getLoc(), type, operands[0],
+          rewriter.getI64ArrayAttr(result.index())));
+    }
+    rewriter.replaceOp(op, elts);
+    return mlir::success();
+  }
+};
+
+struct LoadOpLowering : public SIRToLLVMPattern<LoadOp> {
+  using SIRToLLVMPattern::SIRToLLVMPattern;
+
+  mlir::LogicalResult
+  lower(LoadOp op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const override {
+    rewriter.replaceOpWithNewOp<LLVM::LoadOp>(op, operands[0]);
+    return mlir::success();
+  }
+};
+
+/// Lowers sir.static_cast.
+///
+/// The signedness of the integers, given by the 'fromUnsigned' and
+/// 'toUnsigned' attributes, selects the kind of extension and of conversion
+/// from/to floats. Casts to i1 compare the value with zero.
+struct StaticCastOpLowering : public SIRToLLVMPattern<StaticCastOp> {
+  using SIRToLLVMPattern::SIRToLLVMPattern;
+
+  mlir::LogicalResult
+  lower(StaticCastOp op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const override {
+    mlir::Type fromType = op.getOperand().getType();
+    mlir::Type toType = op.getType();
+    mlir::Type llvmToType = converter.convertType(toType);
+    if (!llvmToType)
+      return mlir::failure();
+    mlir::Value value = operands[0];
+    mlir::Location loc = op.getLoc();
+
+    // Casts between pointers and references don't change the address.
+    bool isFromPointer = fromType.isa<PointerType>() ||
+                         fromType.isa<ReferenceType>();
+    bool isToPointer = toType.isa<PointerType>() ||
+                       toType.isa<ReferenceType>();
+    if (isFromPointer && isToPointer) {
+      if (value.getType() == llvmToType)
+        rewriter.replaceOp(op, value);
+      else
+        rewriter.replaceOpWithNewOp<LLVM::BitcastOp>(op, llvmToType, value);
+      return mlir::success();
+    }
+
+    if (auto fromIntType = fromType.dyn_cast<mlir::IntegerType>()) {
+      unsigned fromWidth = fromIntType.getWidth();
+      if (auto toIntType = toType.dyn_cast<mlir::IntegerType>()) {
+        unsigned toWidth = toIntType.getWidth();
+        if (toWidth == 1) {
+          mlir::Value zero = rewriter.create<LLVM::ConstantOp>(
+              loc, value.getType(), rewriter.getIntegerAttr(fromType, 0));
+          rewriter.replaceOpWithNewOp<LLVM::ICmpOp>(
+              op, LLVM::ICmpPredicate::ne, value, zero);
+        } else if (toWidth < fromWidth)
+          rewriter.replaceOpWithNewOp<LLVM::TruncOp>(op, llvmToType, value);
+        else if (op.isUnsignedOperand())
+          rewriter.replaceOpWithNewOp<LLVM::ZExtOp>(op, llvmToType, value);
+        else
+          rewriter.replaceOpWithNewOp<LLVM::SExtOp>(op, llvmToType, value);
+        return mlir::success();
+      }
+      if (toType.isa<mlir::FloatType>()) {
+        if (op.isUnsignedOperand())
+          rewriter.replaceOpWithNewOp<LLVM::UIToFPOp>(op, llvmToType, value);
+        else
+          rewriter.replaceOpWithNewOp<LLVM::SIToFPOp>(op, llvmToType, value);
+        return mlir::success();
+      }
+    }
+
+    if (auto fromFloatType = fromType.dyn_cast<mlir::FloatType>()) {
+      if (auto toIntType = toType.dyn_cast<mlir::IntegerType>()) {
+        if (toIntType.getWidth() == 1) {
+          mlir::Value zero = rewriter.create<LLVM::ConstantOp>(
+              loc, value.getType(), rewriter.getFloatAttr(fromType, 0.0));
+          rewriter.replaceOpWithNewOp<LLVM::FCmpOp>(
+              op, LLVM::FCmpPredicate::une, value, zero);
+        } else if (op.isUnsignedResult())
+          rewriter.replaceOpWithNewOp<LLVM::FPToUIOp>(op, llvmToType, value);
+        else
+          rewriter.replaceOpWithNewOp<LLVM::FPToSIOp>(op, llvmToType, value);
+        return mlir::success();
+      }
+      if (auto toFloatType = toType.dyn_cast<mlir::FloatType>()) {
+        if (toFloatType.getWidth() < fromFloatType.getWidth())
+          rewriter.replaceOpWithNewOp<LLVM::FPTruncOp>(op, llvmToType, value);
+        else
+          rewriter.replaceOpWithNewOp<LLVM::FPExtOp>(op, llvmToType, value);
+        return mlir::success();
+      }
+    }
+
+    // Other casts can't change the representation of the value.
+    if (value.getType() != llvmToType)
+      return mlir::failure();
+    rewriter.replaceOp(op, value);
+    return mlir::success();
+  }
+};
+
+struct StoreOpLowering : public SIRToLLVMPattern<StoreOp> {
+  using SIRToLLVMPattern::SIRToLLVMPattern;
+
+  mlir::LogicalResult
+  lower(StoreOp op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const override {
+    // The operands of sir.store are the value, then the pointer.
+    rewriter.replaceOpWithNewOp<LLVM::StoreOp>(op, operands[0], operands[1]);
+    return mlir::success();
+  }
+};
+
+struct VoidConstantOpLowering : public SIRToLLVMPattern<VoidConstantOp> {
+  using SIRToLLVMPattern::SIRToLLVMPattern;
+
+  mlir::LogicalResult
+  lower(VoidConstantOp op, ArrayRef<mlir::Value> operands,
+        mlir::ConversionPatternRewriter &rewriter) const override {
+    mlir::Type type = converter.convertType(op.getType());
+    if (!type)
+      return mlir::failure();
+    rewriter.replaceOpWithNewOp<LLVM::UndefOp>(op, type);
+    return mlir::success();
+  }
+};
+
+/// Moves the content of every sir.block in \p module into the block that
+/// contains it.
+void inlineBlockOps(mlir::ModuleOp module) {
+  // Walk the innermost sir.blocks first, so their content is moved as far as
+  // possible.
+  module.walk([&](BlockOp blockOp) {
+    mlir::Block &body = blockOp.getEntryBlock();
+    body.getTerminator()->erase();
+    mlir::Operation *op = blockOp.getOperation();
+    op->getBlock()->getOperations().splice(op->getIterator(),
+                                           body.getOperations());
+    op->erase();
+  });
+}
+
+/// Replaces every sir.default_return in \p module with a std.return.
+/// \returns failure if a sir.default_return is in a function that returns a
+/// value, as such functions may end without returning one.
+mlir::LogicalResult legalizeDefaultReturns(mlir::ModuleOp module) {
+  bool success = true;
+  module.walk([&](DefaultReturnOp op) {
+    if (op.getFuncOp().getType().getNumResults() != 0) {
+      op.emitError("non-void function may end without returning a value");
+      success = false;
+      return;
+    }
+    mlir::OpBuilder builder(op);
+    builder.create<mlir::ReturnOp>(op.getLoc());
+    op.erase();
+  });
+  return mlir::success(success);
+}
+
+/// The SIR to LLVM dialect lowering pass.
+struct LowerToLLVMPass
+    : public mlir::PassWrapper<LowerToLLVMPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  void runOnOperation() override {
+    mlir::ModuleOp module = getOperation();
+
+    // sir.block and sir.default_return don't have an LLVM equivalent, so
+    // they're legalized before the conversion.
+    inlineBlockOps(module);
+    if (mlir::failed(legalizeDefaultReturns(module)))
+      return signalPassFailure();
+
+    SIRTypeConverter typeConverter(&getContext());
+    mlir::OwningRewritePatternList patterns;
+    mlir::populateStdToLLVMConversionPatterns(typeConverter, patterns);
+    patterns.insert<AllocStackOpLowering, BitNotOpLowering,
+                    CreateTupleOpLowering, DestructureTupleOpLowering,
+                    LoadOpLowering, StaticCastOpLowering, StoreOpLowering,
+                    VoidConstantOpLowering>(typeConverter);
+
+    mlir::LLVMConversionTarget target(getContext());
+    target.addLegalOp<mlir::ModuleOp, mlir::ModuleTerminatorOp>();
+    if (mlir::failed(mlir::applyFullConversion(module, target, patterns)))
+      signalPassFailure();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> sora::sir::createLowerToLLVMPass() {
+  return std::make_unique<LowerToLLVMPass>();
+}
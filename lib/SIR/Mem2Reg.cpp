@@ -0,0 +1,364 @@
+//===--- Mem2Reg.cpp - Stack Slot Promotion ---------------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the "mem2reg" pass, which promotes the stack slots created
+// by sir.alloc_stack to SSA values and block arguments.
+//
+// A slot is promoted if it doesn't escape: it must only be used as the pointer
+// operand of sir.load and sir.store operations. The stores must be in the
+// region that contains the sir.alloc_stack, but loads can also be nested in
+// sir.block operations of that region, as they can use its values.
+// Slots that may be read before being written are not promoted.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Sora/SIR/Passes.hpp"
+
+#include "Sora/Common/LLVM.hpp"
+#include "Sora/SIR/Dialect.hpp"
+#include "mlir/IR/Dominance.h"
+#include "mlir/IR/Function.h"
+#include "mlir/Interfaces/ControlFlowInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include <algorithm>
+
+using namespace sora;
+using namespace sora::sir;
+
+#define DEBUG_TYPE "sir-mem2reg"
+
+ALWAYS_ENABLED_STATISTIC(numPromotedSlots,
+                         "# of stack slots promoted to SSA values");
+ALWAYS_ENABLED_STATISTIC(numBlockArguments,
+                         "# of block arguments created by mem2reg");
+
+namespace {
+/// Promotes a single AllocStackOp to SSA values.
+class StackSlotPromoter {
+  /// A LoadOp or StoreOp that uses the slot, and the operation of the region
+  /// that contains it (the access itself, or a BlockOp for nested loads).
+  struct Access {
+    mlir::Operation *op;
+    mlir::Operation *ancestor;
+  };
+
+  /// Information about a block of the region that contains the slot.
+  struct BlockInfo {
+    /// The accesses of this block, in program order.
+    SmallVector<Access, 4> accesses;
+    /// Whether the slot is always initialized when entering this block.
+    bool initializedOnEntry = true;
+    /// Whether this block stores into the slot.
+    bool hasStore = false;
+    /// The value of the slot at the end of this block.
+    mlir::Value outValue;
+  };
+
+  AllocStackOp alloc;
+  mlir::Region &region;
+  mlir::DominanceInfo &domInfo;
+  llvm::DenseMap<mlir::Block *, BlockInfo> blocks;
+  /// The values that replace the loads of the slot.
+  llvm::DenseMap<mlir::Value, mlir::Value> loadReplacements;
+  /// The number of block arguments added by promote() and still in use.
+  unsigned numArgs = 0;
+
+  /// Collects the accesses of the slot.
+  /// \returns false if the slot escapes, or is used in a way that prevents its
+  /// promotion.
+  bool collectAccesses();
+
+  /// Computes initializedOnEntry for each block, and checks that the slot is
+  /// never read before being initialized.
+  /// \returns false if the slot may be read before being initialized.
+  bool checkInitialization();
+
+  /// \returns whether the terminators of the predecessors of every block
+  /// that will receive a block argument implement the BranchOpInterface.
+  bool canAddBlockArguments();
+
+  /// Replaces the accesses with SSA values and block arguments, and erases
+  /// the AllocStackOp.
+  void promote();
+
+  /// \returns the value that replaces \p value, which may be a load of the
+  /// slot that has already been replaced, or \p value itself.
+  mlir::Value getReplacement(mlir::Value value) const;
+
+  /// Removes the block arguments of \p args whose incoming values are all
+  /// the same, replacing them with that value.
+  void removeRedundantArguments(MutableArrayRef<mlir::BlockArgument> args);
+
+  /// \returns the value that flows into \p arg if it's the same value for
+  /// every predecessor (ignoring \p arg itself), or nullptr otherwise.
+  mlir::Value getUniqueIncomingValue(mlir::BlockArgument arg);
+
+public:
+  StackSlotPromoter(AllocStackOp alloc, mlir::DominanceInfo &domInfo)
+      : alloc(alloc), region(*alloc.getOperation()->getParentRegion()),
+        domInfo(domInfo) {}
+
+  /// Promotes the slot if possible.
+  /// \returns true if the slot was promoted.
+  bool run() {
+    // The slot must be allocated in the entry block, else it could be
+    // re-allocated in a loop.
+    if (alloc.getOperation()->getBlock() != &region.front())
+      return false;
+    // Create the BlockInfos now so references to them stay valid.
+    for (mlir::Block &block : region)
+      blocks[&block];
+    if (!collectAccesses() || !checkInitialization() || !canAddBlockArguments())
+      return false;
+    promote();
+    return true;
+  }
+
+  /// \returns the number of block arguments created to promote the slot.
+  unsigned getNumBlockArguments() const { return numArgs; }
+};
+} // namespace
+
+bool StackSlotPromoter::collectAccesses() {
+  mlir::Value slot = alloc.getResult();
+  for (mlir::Operation *user : slot.getUsers()) {
+    if (auto store = dyn_cast<StoreOp>(user)) {
+      // Storing the address of the slot makes it escape, and stores in nested
+      // regions can't be seen by the rest of the region.
+      if ((store.getValue() == slot) || (user->getParentRegion() != &region))
+        return false;
+    } else if (!isa<LoadOp>(user)) {
+      return false;
+    }
+
+    // Loads can be nested in BlockOps, but not in other operations.
+    mlir::Operation *ancestor = user;
+    while (ancestor->getParentRegion() != &region) {
+      ancestor = ancestor->getParentOp();
+      if (!isa<BlockOp>(ancestor))
+        return false;
+    }
+
+    BlockInfo &info = blocks[ancestor->getBlock()];
+    info.accesses.push_back({user, ancestor});
+    info.hasStore |= isa<StoreOp>(user);
+  }
+
+  // Sort the accesses of each block in program order. Loads nested in the
+  // same BlockOp don't need to be sorted as they all see the same value.
+  for (auto &entry : blocks) {
+    std::stable_sort(entry.second.accesses.begin(),
+                     entry.second.accesses.end(),
+                     [](const Access &lhs, const Access &rhs) {
+                       return lhs.ancestor->isBeforeInBlock(rhs.ancestor);
+                     });
+  }
+  return true;
+}
+
+bool StackSlotPromoter::checkInitialization() {
+  // The slot is initialized when entering a block if it's initialized when
+  // leaving each of its predecessors. Iterate until we reach a fixed point.
+  mlir::Block *entryBlock = &region.front();
+  blocks[entryBlock].initializedOnEntry = false;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (mlir::Block &block : region) {
+      BlockInfo &info = blocks[&block];
+      if (!info.initializedOnEntry)
+        continue;
+      for (mlir::Block *pred : block.getPredecessors()) {
+        BlockInfo &predInfo = blocks[pred];
+        if (!predInfo.initializedOnEntry && !predInfo.hasStore) {
+          info.initializedOnEntry = false;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+
+  // Check that every load sees an initialized slot.
+  for (auto &entry : blocks) {
+    bool initialized = entry.second.initializedOnEntry;
+    for (const Access &access : entry.second.accesses) {
+      if (isa<StoreOp>(access.op))
+        initialized = true;
+      else if (!initialized)
+        return false;
+    }
+  }
+  return true;
+}
+
+bool StackSlotPromoter::canAddBlockArguments() {
+  for (mlir::Block &block : region) {
+    if (!blocks[&block].initializedOnEntry)
+      continue;
+    for (auto it = block.pred_begin(), end = block.pred_end(); it != end;
+         ++it) {
+      auto branch = dyn_cast<mlir::BranchOpInterface>((*it)->getTerminator());
+      if (!branch)
+        return false;
+      if (!branch.getMutableSuccessorOperands(it.getSuccessorIndex()))
+        return false;
+    }
+  }
+  return true;
+}
+
+void StackSlotPromoter::promote() {
+  mlir::Type type = alloc.getPointerType().getPointeeType();
+  SmallVector<mlir::BlockArgument, 4> args;
+  SmallVector<mlir::Operation *, 8> loads;
+
+  // Replace the loads with the value of the slot, and remove the stores.
+  // Blocks where the slot is initialized on entry receive its value as a block
+  // argument.
+  //
+  // Blocks aren't visited in dominance order, so a stored value can be a load
+  // of the slot that hasn't been replaced yet. The loads are only erased once
+  // every value has been resolved using getReplacement.
+  for (mlir::Block &block : region) {
+    BlockInfo &info = blocks[&block];
+    mlir::Value value;
+    if (info.initializedOnEntry) {
+      mlir::BlockArgument arg = block.addArgument(type);
+      args.push_back(arg);
+      value = arg;
+      ++numArgs;
+    }
+    for (const Access &access : info.accesses) {
+      if (auto store = dyn_cast<StoreOp>(access.op)) {
+        value = store.getValue();
+        access.op->erase();
+        continue;
+      }
+      mlir::Value load = access.op->getResult(0);
+      load.replaceAllUsesWith(value);
+      loadReplacements[load] = value;
+      loads.push_back(access.op);
+    }
+    info.outValue = value;
+  }
+
+  // Pass the value of the slot to the new block arguments.
+  for (mlir::BlockArgument arg : args) {
+    mlir::Block *block = arg.getOwner();
+    for (auto it = block->pred_begin(), end = block->pred_end(); it != end;
+         ++it) {
+      auto branch = cast<mlir::BranchOpInterface>((*it)->getTerminator());
+      branch.getMutableSuccessorOperands(it.getSuccessorIndex())
+          ->append(getReplacement(blocks[*it].outValue));
+    }
+  }
+
+  for (mlir::Operation *load : loads) {
+    assert(load->use_empty() && "Load is still used!");
+    load->erase();
+  }
+  alloc.erase();
+  removeRedundantArguments(args);
+}
+
+mlir::Value StackSlotPromoter::getReplacement(mlir::Value value) const {
+  // A load can be replaced by another load, so follow the chain.
+  auto it = loadReplacements.find(value);
+  while (it != loadReplacements.end()) {
+    value = it->second;
+    it = loadReplacements.find(value);
+  }
+  return value;
+}
+
+mlir::Value StackSlotPromoter::getUniqueIncomingValue(mlir::BlockArgument arg) {
+  mlir::Block *block = arg.getOwner();
+  mlir::Value uniqueValue;
+  for (auto it = block->pred_begin(), end = block->pred_end(); it != end;
+       ++it) {
+    auto branch = cast<mlir::BranchOpInterface>((*it)->getTerminator());
+    mlir::Value value = (*branch.getSuccessorOperands(
+        it.getSuccessorIndex()))[arg.getArgNumber()];
+    if ((value == arg) || (value == uniqueValue))
+      continue;
+    if (uniqueValue)
+      return nullptr;
+    uniqueValue = value;
+  }
+  // In unreachable code, the value may not dominate the block.
+  if (!uniqueValue || !domInfo.properlyDominates(uniqueValue, &block->front()))
+    return nullptr;
+  return uniqueValue;
+}
+
+void StackSlotPromoter::removeRedundantArguments(
+    MutableArrayRef<mlir::BlockArgument> args) {
+  // Removing an argument can make other arguments redundant, so iterate until
+  // we reach a fixed point.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (mlir::BlockArgument &arg : args) {
+      if (!arg)
+        continue;
+      mlir::Value value = getUniqueIncomingValue(arg);
+      if (!value)
+        continue;
+
+      mlir::Block *block = arg.getOwner();
+      unsigned argNumber = arg.getArgNumber();
+      for (auto it = block->pred_begin(), end = block->pred_end(); it != end;
+           ++it) {
+        auto branch = cast<mlir::BranchOpInterface>((*it)->getTerminator());
+        branch.getMutableSuccessorOperands(it.getSuccessorIndex())
+            ->erase(argNumber);
+      }
+      arg.replaceAllUsesWith(value);
+      block->eraseArgument(argNumber);
+      arg = mlir::BlockArgument();
+      --numArgs;
+      changed = true;
+    }
+  }
+}
+
+namespace {
+/// The mem2reg pass: promotes the stack slots of a function to SSA values.
+struct Mem2RegPass
+    : public mlir::PassWrapper<Mem2RegPass, mlir::FunctionPass> {
+  void runOnFunction() override {
+    // Collect the AllocStackOps first, as promoting them erases operations.
+    SmallVector<AllocStackOp, 16> allocs;
+    getFunction().walk([&](AllocStackOp alloc) { allocs.push_back(alloc); });
+
+    // Updating a statistic is an atomic operation, so count locally and only
+    // update them once.
+    mlir::DominanceInfo &domInfo = getAnalysis<mlir::DominanceInfo>();
+    unsigned promotedSlots = 0, blockArguments = 0;
+    for (AllocStackOp alloc : allocs) {
+      StackSlotPromoter promoter(alloc, domInfo);
+      if (!promoter.run())
+        continue;
+      ++promotedSlots;
+      blockArguments += promoter.getNumBlockArguments();
+    }
+    numPromotedSlots += promotedSlots;
+    numBlockArguments += blockArguments;
+
+    if (!promotedSlots)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> sora::sir::createMem2RegPass() {
+  return std::make_unique<Mem2RegPass>();
+}
@@ -0,0 +1,53 @@
+//===--- Passes.cpp ---------------------------------------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+
+#include "Sora/SIR/Passes.hpp"
+#include "mlir/IR/Function.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "mlir/Transforms/Passes.h"
+
+using namespace sora;
+
+void sora::sir::buildSIRPassPipeline(mlir::OpPassManager &pm,
+                                     unsigned optLevel) {
+  assert(optLevel <= 2 && "Unknown optimization level");
+
+  // Functions are independent, so the function passes can be run on multiple
+  // functions concurrently.
+  mlir::OpPassManager &funcPM = pm.nest<mlir::FuncOp>();
+  if (optLevel > 0)
+    funcPM.addPass(createSROAPass());
+  funcPM.addPass(createMem2RegPass());
+  if (optLevel == 0)
+    return;
+
+  funcPM.addPass(mlir::createCanonicalizerPass());
+  funcPM.addPass(mlir::createCSEPass());
+  if (optLevel == 1)
+    return;
+
+  // The inliner also canonicalizes the functions it changes.
+  pm.addPass(mlir::createInlinerPass());
+  mlir::OpPassManager &postInlineFuncPM = pm.nest<mlir::FuncOp>();
+  postInlineFuncPM.addPass(mlir::createSCCPPass());
+  postInlineFuncPM.addPass(mlir::createCanonicalizerPass());
+  postInlineFuncPM.addPass(mlir::createCSEPass());
+}
+
+void sora::sir::registerSIRPasses() {
+  mlir::registerPass("sir-mem2reg",
+                     "Promote stack slots to SSA values and block arguments",
+                     createMem2RegPass);
+  mlir::registerPass("sir-sroa",
+                     "Split tuple stack slots into one slot per element",
+                     createSROAPass);
+  mlir::registerPass("convert-sir-to-llvm",
+                     "Lower SIR and StandardOps operations to the LLVM dialect",
+                     createLowerToLLVMPass);
+}
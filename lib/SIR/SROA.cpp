@@ -0,0 +1,203 @@
+//===--- SROA.cpp - Scalar Replacement of Tuples ----------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the "sroa" pass, which splits the tuple-typed stack slots
+// created by sir.alloc_stack into one stack slot per tuple element.
+//
+// A slot is split if it doesn't escape: it must only be used as the pointer
+// operand of sir.load and sir.store operations. Stores of a tuple become
+// stores of its elements, and loads of a tuple become loads of its elements.
+// This removes the aggregate copies, and lets mem2reg promote the elements
+// individually.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Sora/SIR/Passes.hpp"
+
+#include "Sora/Common/LLVM.hpp"
+#include "Sora/SIR/Dialect.hpp"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+
+using namespace sora;
+using namespace sora::sir;
+
+#define DEBUG_TYPE "sir-sroa"
+
+ALWAYS_ENABLED_STATISTIC(numSplitSlots, "# of tuple stack slots split by SROA");
+ALWAYS_ENABLED_STATISTIC(
+    numForwardedDestructures,
+    "# of sir.destructure_tuple replaced by element loads");
+
+namespace {
+/// Splits a tuple-typed AllocStackOp into one AllocStackOp per element.
+class TupleSlotSplitter {
+  AllocStackOp alloc;
+  mlir::TupleType tupleType;
+  /// The stack slots of the elements of the tuple.
+  SmallVector<mlir::Value, 4> eltSlots;
+  /// The number of sir.destructure_tuple replaced by element loads.
+  unsigned forwardedDestructures = 0;
+
+  /// \returns whether the slot is only used by LoadOps and StoreOps.
+  bool canSplit();
+
+  /// Replaces \p store with stores of each element of the tuple.
+  void splitStore(StoreOp store);
+
+  /// Replaces \p load with loads of each element of the tuple.
+  void splitLoad(LoadOp load);
+
+public:
+  TupleSlotSplitter(AllocStackOp alloc, mlir::TupleType tupleType)
+      : alloc(alloc), tupleType(tupleType) {}
+
+  /// Splits the slot if possible, adding the new slots that have a tuple type
+  /// to \p newTupleSlots.
+  /// \returns true if the slot was split.
+  bool run(SmallVectorImpl<AllocStackOp> &newTupleSlots);
+
+  /// \returns the number of sir.destructure_tuple replaced by element loads.
+  unsigned getNumForwardedDestructures() const {
+    return forwardedDestructures;
+  }
+};
+} // namespace
+
+bool TupleSlotSplitter::canSplit() {
+  mlir::Value slot = alloc.getResult();
+  for (mlir::Operation *user : slot.getUsers()) {
+    // Storing the address of the slot makes it escape.
+    if (auto store = dyn_cast<StoreOp>(user)) {
+      if (store.getValue() == slot)
+        return false;
+    } else if (!isa<LoadOp>(user)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TupleSlotSplitter::splitStore(StoreOp store) {
+  mlir::OpBuilder builder(store);
+  mlir::Location loc = store.getLoc();
+  mlir::Value tuple = store.getValue();
+
+  // Store the operands of sir.create_tuple directly instead of destructuring
+  // the tuple it creates.
+  SmallVector<mlir::Value, 4> elts;
+  mlir::Operation *tupleOp = tuple.getDefiningOp();
+  if (auto createTuple = dyn_cast_or_null<CreateTupleOp>(tupleOp)) {
+    elts.append(createTuple.getOperands().begin(),
+                createTuple.getOperands().end());
+  } else {
+    auto destructure = builder.create<DestructureTupleOp>(loc, tuple);
+    elts.append(destructure.getResults().begin(),
+                destructure.getResults().end());
+  }
+
+  for (size_t k = 0; k < elts.size(); ++k)
+    builder.create<StoreOp>(loc, elts[k], eltSlots[k]);
+  store.erase();
+
+  // Don't leave a dead sir.create_tuple behind.
+  if (tupleOp && isa<CreateTupleOp>(tupleOp) && tupleOp->use_empty())
+    tupleOp->erase();
+}
+
+void TupleSlotSplitter::splitLoad(LoadOp load) {
+  mlir::OpBuilder builder(load);
+  mlir::Location loc = load.getLoc();
+
+  SmallVector<mlir::Value, 4> elts;
+  elts.reserve(eltSlots.size());
+  for (mlir::Value eltSlot : eltSlots)
+    elts.push_back(builder.create<LoadOp>(loc, eltSlot));
+
+  // sir.destructure_tuple of the loaded tuple can use the elements directly.
+  mlir::Value tuple = load.getResult();
+  for (mlir::Operation *user : llvm::make_early_inc_range(tuple.getUsers())) {
+    auto destructure = dyn_cast<DestructureTupleOp>(user);
+    if (!destructure)
+      continue;
+    for (size_t k = 0; k < elts.size(); ++k)
+      destructure.getResult(k).replaceAllUsesWith(elts[k]);
+    destructure.erase();
+    ++forwardedDestructures;
+  }
+
+  // Other users need the whole tuple.
+  if (!tuple.use_empty())
+    tuple.replaceAllUsesWith(builder.create<CreateTupleOp>(loc, elts));
+  load.erase();
+}
+
+bool TupleSlotSplitter::run(SmallVectorImpl<AllocStackOp> &newTupleSlots) {
+  if (!canSplit())
+    return false;
+
+  mlir::OpBuilder builder(alloc);
+  for (mlir::Type eltType : tupleType.getTypes()) {
+    auto eltSlot = builder.create<AllocStackOp>(alloc.getLoc(),
+                                                PointerType::get(eltType));
+    eltSlots.push_back(eltSlot);
+    if (eltType.isa<mlir::TupleType>())
+      newTupleSlots.push_back(eltSlot);
+  }
+
+  mlir::Value slot = alloc.getResult();
+  for (mlir::Operation *user : llvm::make_early_inc_range(slot.getUsers())) {
+    if (auto store = dyn_cast<StoreOp>(user))
+      splitStore(store);
+    else
+      splitLoad(cast<LoadOp>(user));
+  }
+
+  alloc.erase();
+  return true;
+}
+
+namespace {
+/// The SROA pass: splits the tuple stack slots of a function.
+struct SROAPass : public mlir::PassWrapper<SROAPass, mlir::FunctionPass> {
+  void runOnFunction() override {
+    SmallVector<AllocStackOp, 16> worklist;
+    getFunction().walk([&](AllocStackOp alloc) {
+      if (alloc.getPointerType().getPointeeType().isa<mlir::TupleType>())
+        worklist.push_back(alloc);
+    });
+
+    // Splitting a slot of nested tuples creates new tuple slots, which are
+    // added to the worklist.
+    // Updating a statistic is an atomic operation, so count locally and only
+    // update them once.
+    unsigned splitSlots = 0, forwardedDestructures = 0;
+    while (!worklist.empty()) {
+      AllocStackOp alloc = worklist.pop_back_val();
+      auto tupleType =
+          alloc.getPointerType().getPointeeType().cast<mlir::TupleType>();
+      TupleSlotSplitter splitter(alloc, tupleType);
+      if (!splitter.run(worklist))
+        continue;
+      ++splitSlots;
+      forwardedDestructures += splitter.getNumForwardedDestructures();
+    }
+    numSplitSlots += splitSlots;
+    numForwardedDestructures += forwardedDestructures;
+
+    if (!splitSlots)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> sora::sir::createSROAPass() {
+  return std::make_unique<SROAPass>();
+}
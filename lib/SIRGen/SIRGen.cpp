@@ -11,11 +11,18 @@
 #include "Sora/AST/Decl.hpp"
 #include "Sora/AST/SourceFile.hpp"
 #include "Sora/EntryPoints.hpp"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Module.h"
+#include "llvm/ADT/Statistic.h"
 
 using namespace sora;
 
+#define DEBUG_TYPE "SIRGen"
+
+ALWAYS_ENABLED_STATISTIC(numFunctionsEmitted, "# of functions emitted");
+ALWAYS_ENABLED_STATISTIC(numOpsEmitted, "# of operations emitted");
+
 //===- SIRGen -------------------------------------------------------------===//
 
 static sir::SIRDialect &getSIRDialect(mlir::MLIRContext &mlirCtxt) {
@@ -32,8 +39,14 @@ SIRGen::SIRGen(ASTContext &astCtxt, mlir::MLIRContext &mlirCtxt,
       sirDialect(getSIRDialect(mlirCtxt)) {}
 
 void SIRGen::genSourceFile(SourceFile &sf, mlir::ModuleOp &mlirModule) {
-  for (ValueDecl *decl : sf.getMembers())
-    mlirModule.push_back(genFunction(cast<FuncDecl>(decl)));
+  for (ValueDecl *decl : sf.getMembers()) {
+    mlir::FuncOp funcOp = genFunction(cast<FuncDecl>(decl));
+    ++numFunctionsEmitted;
+    // Only walk the function when someone is going to look at the count.
+    if (llvm::AreStatisticsEnabled())
+      funcOp.walk([&](mlir::Operation *) { ++numOpsEmitted; });
+    mlirModule.push_back(funcOp);
+  }
 }
 
 mlir::Location SIRGen::getLoc(SourceLoc loc) {
@@ -42,7 +55,8 @@ mlir::Location SIRGen::getLoc(SourceLoc loc) {
 
   BufferID buffer = srcMgr.findBufferContainingLoc(loc);
   StringRef filename = srcMgr.getBufferName(buffer);
-  std::pair<unsigned, unsigned> lineAndCol = srcMgr.getLineAndColumn(loc);
+  std::pair<unsigned, unsigned> lineAndCol =
+      srcMgr.getLineAndColumn(loc, buffer);
   return mlir::FileLineColLoc::get(filename, lineAndCol.first,
                                    lineAndCol.second, &mlirCtxt);
 }
@@ -64,6 +78,7 @@ void sora::registerMLIRDialects() {
 
   mlir::registerDialect<sir::SIRDialect>();
   mlir::registerDialect<mlir::StandardOpsDialect>();
+  mlir::registerDialect<mlir::LLVM::LLVMDialect>();
 
 #ifndef NDEBUG
   hasRegisteredMLIRDialects = true;
@@ -81,6 +81,12 @@ void getExprElements(Expr *expr, SmallVectorImpl<Expr *> &elts) {
   elts.push_back(expr);
 }
 
+/// \returns true if \p type is an unsigned integer type.
+bool isUnsignedIntegerType(Type type) {
+  auto *intType = type->getCanonicalType()->getAs<IntegerType>();
+  return intType && intType->isUnsigned();
+}
+
 //===- ExprGenerator -----------------------------------------------------===//
 
 namespace {
@@ -261,14 +267,20 @@ mlir::Value ExprGenerator::visitCastExpr(CastExpr *expr) {
 
   // Convert the result type and the loc to their MLIR equivalent.
   mlir::Type mlirType = getType(type);
-  assert(mlirType != subExprValue.getType() && "Cast is useless!");
+
+  // SIR integers are signless, so casts that only change the signedness of an
+  // integer (e.g. i32 to u32) don't change its representation.
+  if (mlirType == subExprValue.getType())
+    return subExprValue;
 
   mlir::Location loc = getNodeLoc(expr);
 
   // Currently, all sora casts are static casts, so just emit a static_cast op.
   // We do not need to handle things like creating maybe types - implicit casts
   // handle those.
-  return builder.create<sir::StaticCastOp>(loc, subExprValue, mlirType);
+  return builder.create<sir::StaticCastOp>(
+      loc, subExprValue, mlirType, isUnsignedIntegerType(subExpr->getType()),
+      isUnsignedIntegerType(type));
 }
 
 mlir::Value ExprGenerator::visitTupleElementExpr(TupleElementExpr *expr) {
@@ -15,11 +15,14 @@ using namespace sora;
 
 #define DEBUG_TYPE "Constraint System "
 
-STATISTIC(numSuccessfulUnifications, "# of successful type unifications");
-STATISTIC(numFailedUnifications, "# of failed type unifications");
-STATISTIC(numCanUnifyCalls, "# of calls to canUnify");
-STATISTIC(numTypeVariablesBound, "# of type variables bound");
-STATISTIC(numTypeVariablesCreated, "# of type variables created");
+ALWAYS_ENABLED_STATISTIC(numSuccessfulUnifications,
+                         "# of successful type unifications");
+ALWAYS_ENABLED_STATISTIC(numFailedUnifications,
+                         "# of failed type unifications");
+ALWAYS_ENABLED_STATISTIC(numCanUnifyCalls, "# of calls to canUnify");
+ALWAYS_ENABLED_STATISTIC(numTypeVariablesBound, "# of type variables bound");
+ALWAYS_ENABLED_STATISTIC(numTypeVariablesCreated,
+                         "# of type variables created");
 
 //===--- TypeUnifier ------------------------------------------------------===//
 
@@ -57,6 +60,7 @@ public:
       return true;
 
     auto setBindingOrUnify = [&](TypeVariableType *tv, Type proposedBinding) {
+      tv = cs.getRepresentative(tv);
       if (cs.isBound(tv))
         return unify(cs.getBinding(tv), proposedBinding);
       return tryBindTypeVariable(tv, proposedBinding);
@@ -147,28 +151,31 @@ public:
   }
 
   bool visitTypeVariableType(TypeVariableType *type, TypeVariableType *other) {
+    // Work on the representatives of the equivalence classes, so we don't
+    // have to walk chains of type variables.
+    type = cs.getRepresentative(type);
+    other = cs.getRepresentative(other);
+
+    // If they're in the same equivalence class, there's nothing to do.
+    if (type == other)
+      return true;
+
     // If they're both bound, unify their respective bindings.
     if (cs.isBound(type) && cs.isBound(other))
       return unify(cs.getBinding(type), cs.getBinding(other));
 
-    // if only 'type' is bound, bind 'other' to 'type', unless 'type' is already
-    // bound to 'other'.
-    if (Type binding = cs.getBinding(type)) {
-      if (binding->getCanonicalType()->getAs<TypeVariableType>() == other)
-        return true;
+    // if only 'type' is bound, bind 'other' to 'type'.
+    if (cs.isBound(type))
       return tryBindTypeVariable(other, type);
-    }
 
-    // if only 'other' is bound, bind 'type' to 'other', unless 'other' is
-    // already bound to 'type'.
-    if (Type binding = cs.getBinding(other)) {
-      if (binding->getAs<TypeVariableType>() == type)
-        return true;
+    // if only 'other' is bound, bind 'type' to 'other'.
+    if (cs.isBound(other))
       return tryBindTypeVariable(type, other);
-    }
 
-    // Else, if they're both unbound, just bind 'type' to 'other', or 'other' to
-    // 'type if the first one doesn't work.
+    // Else, if they're both unbound, bind the one with the lowest rank to the
+    // other one, or do the opposite if that doesn't work.
+    if (cs.getRank(type) > cs.getRank(other))
+      std::swap(type, other);
     return tryBindTypeVariable(type, other) || tryBindTypeVariable(other, type);
   }
 };
@@ -176,6 +183,12 @@ public:
 
 //===--- ConstraintSystem -------------------------------------------------===//
 
+ConstraintSystem::~ConstraintSystem() {
+  numSuccessfulUnifications += successfulUnifications;
+  numFailedUnifications += failedUnifications;
+  numCanUnifyCalls += canUnifyCalls;
+}
+
 TypeVariableType *ConstraintSystem::createTypeVariable(TypeVariableKind kind) {
   auto *tyVar = new (*this) TypeVariableType(*this, kind, typeVariables.size());
   typeVariables.push_back(tyVar);
@@ -188,7 +201,7 @@ bool ConstraintSystem::unify(Type a, Type b,
   assert(b && "b is null");
   TypeUnifier unifier(*this, options, /*canBindTypeVariables*/ true);
   bool result = unifier.unify(a, b);
-  result ? ++numSuccessfulUnifications : ++numFailedUnifications;
+  result ? ++successfulUnifications : ++failedUnifications;
   return result;
 }
 
@@ -196,7 +209,7 @@ bool ConstraintSystem::canUnify(Type a, Type b,
                                 const UnificationOptions &options) const {
   assert(a && "a is null");
   assert(b && "b is null");
-  ++numCanUnifyCalls;
+  ++canUnifyCalls;
   return TypeUnifier(*const_cast<ConstraintSystem *>(this), options,
                      /*canBindTypeVariables*/ false)
       .unify(a, b);
@@ -61,6 +61,8 @@ public:
   ConstraintSystem(const ConstraintSystem &) = delete;
   ConstraintSystem &operator=(const ConstraintSystem &) = delete;
 
+  ~ConstraintSystem();
+
   TypeChecker &typeChecker;
 
 private:
@@ -68,6 +70,12 @@ private:
   /// by dumpTypeVariables().
   SmallVector<TypeVariableType *, 8> typeVariables;
 
+  /// Unification counters, only added to the global statistics when the
+  /// ConstraintSystem is destroyed, as updating them is an atomic operation.
+  unsigned successfulUnifications = 0;
+  unsigned failedUnifications = 0;
+  mutable unsigned canUnifyCalls = 0;
+
   /// Creates a new type variable of kind \p kind
   TypeVariableType *createTypeVariable(TypeVariableKind kind);
 
@@ -122,12 +130,14 @@ public:
     if (!type->hasTypeVariable())
       return;
     // FIXME: it'd be great if there was a "walk" method.
-    type->rebuildType([&](Type type) -> Type {
-      if (TypeVariableType *tyVar = type->getAs<TypeVariableType>())
-        if (!isBound(tyVar))
-          bind(tyVar, ctxt.errorType);
-      return {};
-    });
+    type->rebuildType(
+        [&](Type type) -> Type {
+          if (TypeVariableType *tyVar = type->getAs<TypeVariableType>())
+            if (!isBound(tyVar))
+              bind(tyVar, ctxt.errorType);
+          return {};
+        },
+        TypeProperties::hasTypeVariable);
   }
 
   void dumpTypeVariables(
@@ -13,9 +13,13 @@
 #include "Sora/AST/ASTVisitor.hpp"
 #include "Sora/AST/Decl.hpp"
 #include "Sora/AST/NameLookup.hpp"
+#include "Sora/AST/SourceFile.hpp"
 #include "Sora/AST/Types.hpp"
+#include "Sora/Diagnostics/DiagnosticConsumer.hpp"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ThreadPool.h"
 
 using namespace sora;
 
@@ -34,21 +38,21 @@ namespace {
 ///
 /// Finally, note that diagnoseDuplicateBinding/noteFirst are called in
 /// groups. For example, in 'let (a, b, a, b)', they're both called for 'a'
-/// first and then for 'b' (or for 'b' then for 'a' - that ordering isn't
-/// guaranteed)
+/// first and then for 'b' (groups are processed in the order in which their
+/// first binding appears)
 void checkForDuplicateBindingsInList(
     ArrayRef<ValueDecl *> decls,
     llvm::function_ref<void(ValueDecl *)> diagnoseDuplicateBinding,
     llvm::function_ref<void(ValueDecl *)> noteFirstBinding) {
   // The map of identifiers -> list of bindings.
-  llvm::DenseMap<Identifier, SmallVector<ValueDecl *, 2>> bindingsMap;
+  llvm::MapVector<Identifier, SmallVector<ValueDecl *, 2>> bindingsMap;
 
   // Collect the bindings
   for (ValueDecl *decl : decls)
     bindingsMap[decl->getIdentifier()].push_back(decl);
 
   // Check them
-  for (auto entry : bindingsMap) {
+  for (auto &entry : bindingsMap) {
     SmallVectorImpl<ValueDecl *> &bindings = entry.second;
     assert(!bindings.empty() && "Empty set of bindings?");
 
@@ -379,7 +383,80 @@ void TypeChecker::typecheckFunctionBody(FuncDecl *func) {
   func->setBodyChecked();
 }
 
-void TypeChecker::typecheckDefinedFunctions() {
+namespace {
+/// A contiguous batch of functions whose bodies are checked on the same
+/// thread, with their own DiagnosticEngine.
+struct FunctionBodyBatch {
+  FunctionBodyBatch(const SourceManager &srcMgr, ArrayRef<FuncDecl *> funcs)
+      : funcs(funcs), diagEngine(srcMgr) {
+    auto consumer = std::make_unique<BufferingDiagnosticConsumer>();
+    diagBuffer = consumer.get();
+    diagEngine.setConsumer(std::move(consumer));
+  }
+
+  ArrayRef<FuncDecl *> funcs;
+  DiagnosticEngine diagEngine;
+  BufferingDiagnosticConsumer *diagBuffer = nullptr;
+};
+
+/// Checks the bodies of \p funcs concurrently using up to \p numThreads
+/// threads.
+///
+/// The functions are split into contiguous batches that each buffer their
+/// diagnostics. Once every batch has been checked, the diagnostics are
+/// replayed in order, so they're emitted exactly like they would have been if
+/// the bodies had been checked serially.
+void typecheckFunctionBodiesConcurrently(ASTContext &ctxt,
+                                         DiagnosticEngine &diagEngine,
+                                         ArrayRef<FuncDecl *> funcs,
+                                         unsigned numThreads) {
+  // Name lookup lazily builds some data structures. They can't be modified
+  // once lookups are performed from multiple threads, so build them now.
+  SourceFile &sf = funcs.front()->getSourceFile();
+  sf.buildLookupTable();
+  sf.getScopeMap()->buildIntervalIndex();
+
+  // Use a few batches per thread so threads that are done early can pick up
+  // some more work.
+  size_t numBatches = std::min<size_t>(funcs.size(), numThreads * 4);
+  size_t batchSize = (funcs.size() + numBatches - 1) / numBatches;
+  std::vector<std::unique_ptr<FunctionBodyBatch>> batches;
+  for (size_t k = 0; k < funcs.size(); k += batchSize)
+    batches.push_back(std::make_unique<FunctionBodyBatch>(
+        ctxt.srcMgr, funcs.slice(k, std::min(batchSize, funcs.size() - k))));
+
+  ctxt.setThreadSafe(true);
+  {
+    llvm::ThreadPool threadPool(llvm::hardware_concurrency(numThreads));
+    for (auto &batch : batches) {
+      FunctionBodyBatch *curBatch = batch.get();
+      threadPool.async([&ctxt, curBatch]() {
+        TypeChecker tc(ctxt, curBatch->diagEngine);
+        for (FuncDecl *func : curBatch->funcs)
+          tc.typecheckFunctionBody(func);
+        assert(tc.definedFunctions.empty() &&
+               "Extra functions were found while checking the bodies "
+               "of defined non-local functions");
+      });
+    }
+    threadPool.wait();
+  }
+  ctxt.setThreadSafe(false);
+
+  for (auto &batch : batches)
+    batch->diagBuffer->flush(
+        [&](const Diagnostic &diagnostic) { diagEngine.replay(diagnostic); });
+}
+} // namespace
+
+void TypeChecker::typecheckDefinedFunctions(unsigned numThreads) {
+  if ((numThreads > 1) && (definedFunctions.size() > 1)) {
+    typecheckFunctionBodiesConcurrently(ctxt, diagEngine, definedFunctions,
+                                        numThreads);
+    definedFunctions.clear();
+    return;
+  }
+
 #ifndef NDEBUG
   size_t numDefinedFunc = definedFunctions.size();
 #endif
@@ -178,6 +178,7 @@ public:
 
   bool visitTypeVariableType(TypeVariableType *from, Type to) {
     // "Dereference" bound type variables
+    from = cs.getRepresentative(from);
     if (Type fromBinding = cs.getBinding(from))
       return visit(fromBinding, to);
     // For Integer Type Variables, use canConvertIntegerTypeTo
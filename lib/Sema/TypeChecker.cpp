@@ -17,15 +17,18 @@ using namespace sora;
 //===- TypeChecker --------------------------------------------------------===//
 
 TypeChecker::TypeChecker(ASTContext &ctxt)
-    : ctxt(ctxt), diagEngine(ctxt.diagEngine) {}
+    : TypeChecker(ctxt, ctxt.diagEngine) {}
+
+TypeChecker::TypeChecker(ASTContext &ctxt, DiagnosticEngine &diagEngine)
+    : ctxt(ctxt), diagEngine(diagEngine) {}
 
 //===- performSema --------------------------------------------------------===//
 
-void sora::performSema(SourceFile &file) {
+void sora::performSema(SourceFile &file, unsigned numThreads) {
   TypeChecker tc(file.astContext);
   // type-check the declarations inside the file
   for (ValueDecl *decl : file.getMembers())
     tc.typecheckDecl(decl);
   // type-check the function bodies
-  tc.typecheckDefinedFunctions();
-}
\ No newline at end of file
+  tc.typecheckDefinedFunctions(numThreads);
+}
@@ -34,6 +34,9 @@ class TypeChecker final {
 
 public:
   TypeChecker(ASTContext &ctxt);
+  /// Creates a TypeChecker that emits its diagnostics using \p diagEngine
+  /// instead of the ASTContext's DiagnosticEngine.
+  TypeChecker(ASTContext &ctxt, DiagnosticEngine &diagEngine);
 
   /// Emits a diagnostic at \p loc
   template <typename... Args>
@@ -57,7 +60,10 @@ public:
   Expr *typecheckBooleanCondition(Expr *expr, DeclContext *dc);
 
   /// Typechecks the body of the functions in \c definedFunctions
-  void typecheckDefinedFunctions();
+  /// \param numThreads the maximum number of threads that can be used. When
+  /// it's greater than 1, bodies are checked concurrently. The diagnostics
+  /// are emitted in the same order as if the bodies were checked serially.
+  void typecheckDefinedFunctions(unsigned numThreads = 1);
 
   /// Typechecks the body of \p func. Does nothing if \p func doesn't have a
   /// body.
@@ -9,6 +9,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Sora/EntryPoints.hpp"
+#include "Sora/SIR/Passes.hpp"
 #include "mlir/IR/AsmState.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/MLIRContext.h"
@@ -66,6 +67,8 @@ void registerSupportedPasses() {
 #include "mlir/Transforms/Passes.h.inc"
 #define GEN_PASS_REGISTRATION
 #include "mlir/Dialect/StandardOps/Transforms/Passes.h.inc"
+
+  ::sora::sir::registerSIRPasses();
 }
 } // namespace sora
 } // namespace mlir
@@ -6,6 +6,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "Sora/AST/ASTContext.hpp"
+#include "Sora/AST/TypeVariableEnvironment.hpp"
+#include "Sora/AST/Types.hpp"
 #include "Sora/Common/SourceManager.hpp"
 #include "Sora/Diagnostics/DiagnosticEngine.hpp"
 #include "llvm/Support/raw_ostream.h"
@@ -41,6 +43,23 @@ TEST_F(ASTContextTest, getIdentifier_emptyAndNullStrings) {
   EXPECT_EQ(ctxt->getIdentifier(StringRef("")).c_str(), nullptr);
 }
 
+TEST_F(ASTContextTest, getIdentifier_hashAndLength) {
+  Identifier foo = ctxt->getIdentifier("foo");
+  EXPECT_EQ(foo.str(), "foo");
+  EXPECT_EQ(foo.str().size(), 3u);
+  // Identifiers with embedded null characters keep their full length.
+  Identifier nul = ctxt->getIdentifier(StringRef("a\0b", 3));
+  EXPECT_EQ(nul.str().size(), 3u);
+  EXPECT_NE(nul, ctxt->getIdentifier("a"));
+  EXPECT_EQ(Identifier().getHash(), 0u);
+
+  // Hashes are deterministic: they only depend on the identifier's string.
+  std::unique_ptr<ASTContext> other{ASTContext::create(srcMgr, diagEngine)};
+  Identifier otherFoo = other->getIdentifier("foo");
+  EXPECT_NE(foo, otherFoo);
+  EXPECT_EQ(foo.getHash(), otherFoo.getHash());
+}
+
 TEST_F(ASTContextTest, cleanup) {
   bool cleanupRan = false;
   ctxt->addCleanup([&]() { cleanupRan = true; });
@@ -96,5 +115,38 @@ TEST_F(ASTContextTest, lookupBuiltinType) {
 }
 
 TEST_F(ASTContextTest, getAllBuiltinTypes) {
-  // TODO
-}
\ No newline at end of file
+  SmallVector<CanType, 16> types;
+  ctxt->getAllBuiltinTypes(types);
+  CanType expected[] = {
+      ctxt->i8Type,    ctxt->i16Type,   ctxt->i32Type,   ctxt->i64Type,
+      ctxt->isizeType, ctxt->u8Type,    ctxt->u16Type,   ctxt->u32Type,
+      ctxt->u64Type,   ctxt->usizeType, ctxt->f32Type,   ctxt->f64Type,
+      ctxt->voidType,  ctxt->boolType,
+  };
+  ASSERT_EQ(types.size(), llvm::array_lengthof(expected));
+  for (size_t k = 0; k < types.size(); ++k)
+    EXPECT_EQ(types[k].getPtr(), expected[k].getPtr());
+
+  // The results are appended to the vector.
+  SmallVector<Type, 16> results{ctxt->errorType};
+  ctxt->getAllBuiltinTypes(results);
+  ASSERT_EQ(results.size(), types.size() + 1);
+  EXPECT_EQ(results.front().getPtr(), ctxt->errorType.getPtr());
+}
+
+TEST_F(ASTContextTest, typeVariableEnvironmentArena) {
+  EXPECT_FALSE(ctxt->hasTypeVariableEnvironmentArena());
+  // The arena is reused by successive environments, and must be emptied every
+  // time an environment is destroyed.
+  for (unsigned k = 0; k < 3; ++k) {
+    TypeVariableEnvironment env(*ctxt);
+    EXPECT_TRUE(ctxt->hasTypeVariableEnvironmentArena());
+    TypeVariableType *tv = TypeVariableType::createGeneralTypeVariable(env, 0);
+    MaybeType *maybe = MaybeType::get(tv);
+    EXPECT_EQ(maybe->getValueType().getPtr(), tv);
+    EXPECT_EQ(MaybeType::get(tv), maybe);
+    EXPECT_NE(ctxt->getMemoryUsed(ArenaKind::TypeVariableEnvironment), 0u);
+  }
+  EXPECT_FALSE(ctxt->hasTypeVariableEnvironmentArena());
+  EXPECT_EQ(ctxt->getMemoryUsed(ArenaKind::TypeVariableEnvironment), 0u);
+}
@@ -0,0 +1,94 @@
+//===--- ASTScopeTests.cpp --------------------------------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+
+#include "Sora/AST/ASTContext.hpp"
+#include "Sora/AST/ASTScope.hpp"
+#include "Sora/AST/Decl.hpp"
+#include "Sora/AST/SourceFile.hpp"
+#include "Sora/AST/Stmt.hpp"
+#include "Sora/Common/SourceManager.hpp"
+#include "Sora/Diagnostics/DiagnosticEngine.hpp"
+#include "gtest/gtest.h"
+
+using namespace sora;
+
+namespace {
+const char *str = "func a() { {} if x {} else {} } func b() { while x {} }";
+
+class ASTScopeTest : public ::testing::Test {
+protected:
+  ASTScopeTest() : sf(SourceFile::create(*ctxt, {}, nullptr)) {
+    srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
+    // func a() { {} if x {} else {} }
+    BlockStmt *inner = BlockStmt::createEmpty(*ctxt, loc(11), loc(12));
+    BlockStmt *then = BlockStmt::createEmpty(*ctxt, loc(19), loc(20));
+    BlockStmt *otherwise = BlockStmt::createEmpty(*ctxt, loc(27), loc(28));
+    IfStmt *ifStmt =
+        new (*ctxt) IfStmt(loc(14), nullptr, then, loc(22), otherwise);
+    BlockStmtElement aElts[] = {inner, ifStmt};
+    FuncDecl *a = createFunc(0, "a");
+    a->setBody(BlockStmt::create(*ctxt, loc(9), aElts, loc(30)));
+    sf->addMember(a);
+    // func b() { while x {} }
+    BlockStmt *body = BlockStmt::createEmpty(*ctxt, loc(51), loc(52));
+    WhileStmt *whileStmt = new (*ctxt) WhileStmt(loc(43), nullptr, body);
+    BlockStmtElement bElts[] = {whileStmt};
+    FuncDecl *b = createFunc(32, "b");
+    b->setBody(BlockStmt::create(*ctxt, loc(41), bElts, loc(54)));
+    sf->addMember(b);
+  }
+
+  SourceLoc loc(unsigned offset) {
+    return SourceLoc::fromPointer(str + offset);
+  }
+
+  FuncDecl *createFunc(unsigned offset, StringRef name) {
+    return new (*ctxt)
+        FuncDecl(sf, loc(offset), loc(offset + 5), ctxt->getIdentifier(name),
+                 ParamList::createEmpty(*ctxt, {}, {}));
+  }
+
+  SourceManager srcMgr;
+  DiagnosticEngine diagEng{srcMgr};
+  std::unique_ptr<ASTContext> ctxt{ASTContext::create(srcMgr, diagEng)};
+
+  SourceFile *sf;
+};
+} // namespace
+
+TEST_F(ASTScopeTest, findInnermostScope) {
+  SourceFileScope *scopeMap = sf->getScopeMap();
+
+  // Check a few locations with the tree walk.
+  EXPECT_EQ(scopeMap->findInnermostScope(loc(31))->getKind(),
+            ASTScopeKind::SourceFile);
+  EXPECT_EQ(scopeMap->findInnermostScope(loc(0))->getKind(),
+            ASTScopeKind::FuncDecl);
+  EXPECT_EQ(scopeMap->findInnermostScope(loc(10))->getKind(),
+            ASTScopeKind::BlockStmt);
+  EXPECT_EQ(scopeMap->findInnermostScope(loc(17))->getKind(),
+            ASTScopeKind::IfStmt);
+  EXPECT_EQ(scopeMap->findInnermostScope(loc(20))->getKind(),
+            ASTScopeKind::BlockStmt);
+  EXPECT_EQ(scopeMap->findInnermostScope(loc(47))->getKind(),
+            ASTScopeKind::WhileStmt);
+
+  // Remember the result of the tree walk for every location, then check that
+  // the interval index gives the same results.
+  size_t len = StringRef(str).size();
+  std::vector<ASTScope *> expected;
+  for (unsigned k = 0; k < len; ++k)
+    expected.push_back(scopeMap->findInnermostScope(loc(k)));
+
+  EXPECT_FALSE(scopeMap->hasIntervalIndex());
+  scopeMap->buildIntervalIndex();
+  EXPECT_TRUE(scopeMap->hasIntervalIndex());
+
+  for (unsigned k = 0; k < len; ++k)
+    EXPECT_EQ(scopeMap->findInnermostScope(loc(k)), expected[k])
+        << "mismatch at offset " << k;
+}
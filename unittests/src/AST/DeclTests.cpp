@@ -25,6 +25,7 @@ class DeclTest : public ::testing::Test {
 protected:
   DeclTest() {
     // Setup SourceLocs
+    srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
     beg = SourceLoc::fromPointer(str);
     mid = SourceLoc::fromPointer(str + 5);
     end = SourceLoc::fromPointer(str + 10);
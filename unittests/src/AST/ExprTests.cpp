@@ -8,6 +8,7 @@
 #include "Sora/AST/ASTContext.hpp"
 #include "Sora/AST/Expr.hpp"
 #include "Sora/AST/TypeRepr.hpp"
+#include "Sora/AST/Types.hpp"
 #include "Sora/Common/SourceManager.hpp"
 #include "Sora/Diagnostics/DiagnosticEngine.hpp"
 #include "llvm/ADT/APFloat.h"
@@ -23,6 +24,7 @@ class ExprTest : public ::testing::Test {
 protected:
   ExprTest() {
     // Setup locs
+    srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
     beg = SourceLoc::fromPointer(str);
     mid = SourceLoc::fromPointer(str + 5);
     end = SourceLoc::fromPointer(str + 10);
@@ -165,6 +167,32 @@ TEST_F(ExprTest, IntegerLiteralExpr_getValue) {
   EXPECT_EQ(expr->getValue().toString(10, true), "200");
 }
 
+TEST_F(ExprTest, IntegerLiteralExpr_getValueCaching) {
+  IntegerLiteralExpr *expr = new (*ctxt) IntegerLiteralExpr("300", {});
+  bool overflows = false;
+  expr->setType(ctxt->i8Type);
+  EXPECT_EQ(expr->getValue(&overflows).toString(10, true), "44");
+  EXPECT_TRUE(overflows);
+  // The second call uses the cached value, including the overflow flag.
+  overflows = false;
+  EXPECT_EQ(expr->getValue(&overflows).toString(10, true), "44");
+  EXPECT_TRUE(overflows);
+  // Changing the type invalidates the cache.
+  expr->setType(ctxt->i16Type);
+  EXPECT_EQ(expr->getValue(&overflows).toString(10, true), "300");
+  EXPECT_FALSE(overflows);
+
+  // Values wider than 64 bits are stored in the ASTContext.
+  IntegerType *u128 =
+      IntegerType::getUnsigned(*ctxt, IntegerWidth::fixed(128));
+  expr = new (*ctxt)
+      IntegerLiteralExpr("340282366920938463463374607431768211455", {});
+  expr->setType(u128);
+  EXPECT_TRUE(expr->getValue().isMaxValue());
+  EXPECT_EQ(expr->getValue().getBitWidth(), 128u);
+  EXPECT_TRUE(expr->getValue().isMaxValue());
+}
+
 TEST_F(ExprTest, FloatLiteralExpr_getValue) {
   FloatLiteralExpr *expr = new (*ctxt) FloatLiteralExpr("3.14", {});
   expr->setType(ctxt->f32Type);
@@ -177,6 +205,18 @@ TEST_F(ExprTest, FloatLiteralExpr_getValue) {
   EXPECT_EQ(StringRef(strVec.data(), 4), "3.14");
 }
 
+TEST_F(ExprTest, FloatLiteralExpr_getValueCaching) {
+  FloatLiteralExpr *expr = new (*ctxt) FloatLiteralExpr("0.1", {});
+  expr->setType(ctxt->f32Type);
+  APFloat value = expr->getValue();
+  EXPECT_TRUE(value.bitwiseIsEqual(expr->getValue()));
+  EXPECT_EQ(&expr->getValue().getSemantics(), &APFloat::IEEEsingle());
+  // Changing the type invalidates the cache.
+  expr->setType(ctxt->f64Type);
+  EXPECT_EQ(&expr->getValue().getSemantics(), &APFloat::IEEEdouble());
+  EXPECT_EQ(expr->getValue().convertToDouble(), 0.1);
+}
+
 TEST_F(ExprTest, UnresolvedExprs) {
   // Create another ASTContext in which we'll allocate a few unresolved expr so
   // we can check that they're properly allocated using
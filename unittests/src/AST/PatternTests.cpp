@@ -22,6 +22,7 @@ class PatternTest : public ::testing::Test {
 protected:
   PatternTest() {
     // Setup SourceLocs
+    srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
     beg = SourceLoc::fromPointer(str);
     mid = SourceLoc::fromPointer(str + 5);
     end = SourceLoc::fromPointer(str + 10);
@@ -0,0 +1,58 @@
+//===--- SourceFileTests.cpp ------------------------------------*- C++ -*-===//
+// Part of the Sora project, licensed under the MIT license.
+// See LICENSE.txt in the project root for license information.
+//
+// Copyright (c) 2019 Pierre van Houtryve
+//===----------------------------------------------------------------------===//
+
+#include "Sora/AST/ASTContext.hpp"
+#include "Sora/AST/Decl.hpp"
+#include "Sora/AST/SourceFile.hpp"
+#include "Sora/Common/SourceManager.hpp"
+#include "Sora/Diagnostics/DiagnosticEngine.hpp"
+#include "gtest/gtest.h"
+
+using namespace sora;
+
+namespace {
+class SourceFileTest : public ::testing::Test {
+protected:
+  SourceFileTest() : sf(SourceFile::create(*ctxt, {}, nullptr)) {}
+
+  FuncDecl *createFunc(StringRef name) {
+    return new (*ctxt) FuncDecl(sf, {}, {}, ctxt->getIdentifier(name),
+                                ParamList::createEmpty(*ctxt, {}, {}));
+  }
+
+  SourceManager srcMgr;
+  DiagnosticEngine diagEng{srcMgr};
+  std::unique_ptr<ASTContext> ctxt{ASTContext::create(srcMgr, diagEng)};
+
+  SourceFile *sf;
+};
+} // namespace
+
+TEST_F(SourceFileTest, lookup) {
+  Identifier foo = ctxt->getIdentifier("foo");
+  Identifier bar = ctxt->getIdentifier("bar");
+  EXPECT_TRUE(sf->lookup(foo).empty());
+
+  FuncDecl *foo1 = createFunc("foo");
+  FuncDecl *bar1 = createFunc("bar");
+  sf->addMember(foo1);
+  sf->addMember(bar1);
+
+  ASSERT_EQ(sf->lookup(foo).size(), 1u);
+  EXPECT_EQ(sf->lookup(foo)[0], foo1);
+  ASSERT_EQ(sf->lookup(bar).size(), 1u);
+  EXPECT_EQ(sf->lookup(bar)[0], bar1);
+  EXPECT_TRUE(sf->lookup(ctxt->getIdentifier("baz")).empty());
+
+  // Members added after the table has been built must be found as well, in
+  // the order in which they were added.
+  FuncDecl *foo2 = createFunc("foo");
+  sf->addMember(foo2);
+  ASSERT_EQ(sf->lookup(foo).size(), 2u);
+  EXPECT_EQ(sf->lookup(foo)[0], foo1);
+  EXPECT_EQ(sf->lookup(foo)[1], foo2);
+}
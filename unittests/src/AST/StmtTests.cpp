@@ -6,7 +6,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "Sora/AST/ASTContext.hpp"
+#include "Sora/AST/Decl.hpp"
 #include "Sora/AST/Expr.hpp"
+#include "Sora/AST/SourceFile.hpp"
 #include "Sora/AST/Stmt.hpp"
 #include "Sora/Common/SourceManager.hpp"
 #include "Sora/Diagnostics/DiagnosticEngine.hpp"
@@ -21,6 +23,7 @@ class StmtTest : public ::testing::Test {
 protected:
   StmtTest() {
     // Setup SourceLocs
+    srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
     beg = SourceLoc::fromPointer(str);
     mid = SourceLoc::fromPointer(str + 5);
     end = SourceLoc::fromPointer(str + 10);
@@ -107,4 +110,21 @@ TEST_F(StmtTest, getSourceRange) {
   EXPECT_EQ(whileStmt->getBegLoc(), beg);
   EXPECT_EQ(whileStmt->getEndLoc(), end);
   EXPECT_EQ(whileStmt->getSourceRange(), SourceRange(beg, end));
-}
\ No newline at end of file
+}
+
+TEST_F(StmtTest, hasFuncDecl) {
+  SourceFile *sf = SourceFile::create(*ctxt, {}, nullptr);
+  FuncDecl *func = new (*ctxt)
+      FuncDecl(sf, {}, {}, {}, ParamList::createEmpty(*ctxt, {}, {}));
+
+  EXPECT_FALSE(cast<BlockStmt>(blockStmt)->hasFuncDecl());
+
+  BlockStmt *block =
+      BlockStmt::create(*ctxt, beg, {continueStmt, breakStmt}, end);
+  EXPECT_FALSE(block->hasFuncDecl());
+  block->setElement(1, func);
+  EXPECT_TRUE(block->hasFuncDecl());
+
+  block = BlockStmt::create(*ctxt, beg, {continueStmt, func}, end);
+  EXPECT_TRUE(block->hasFuncDecl());
+}
@@ -19,6 +19,7 @@ class TypeReprTest : public ::testing::Test {
 protected:
   TypeReprTest() {
     // Setup SourceLocs
+    srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
     beg = SourceLoc::fromPointer(str);
     mid = SourceLoc::fromPointer(str + 5);
     end = SourceLoc::fromPointer(str + 10);
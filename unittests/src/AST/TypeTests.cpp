@@ -96,6 +96,27 @@ TEST_F(TypeTest, ReferenceTypeWithoutMut) {
   EXPECT_EQ(immut, mut->withoutMut());
 }
 
+TEST_F(TypeTest, wrapperTypesUniquing) {
+  // Reference, Maybe and LValue types share the same uniquing table: make sure
+  // that every (kind, wrapped type) pair gives a distinct type, and that the
+  // same type is returned for the same pair.
+  SmallVector<Type, 8> types;
+  for (Type base : {Type(ctxt->i32Type), Type(ctxt->i64Type), refType}) {
+    types.push_back(ReferenceType::get(base, false));
+    types.push_back(ReferenceType::get(base, true));
+    types.push_back(MaybeType::get(base));
+    types.push_back(LValueType::get(base));
+  }
+
+  for (size_t i = 0; i < types.size(); ++i)
+    for (size_t j = i + 1; j < types.size(); ++j)
+      EXPECT_NE(types[i].getPtr(), types[j].getPtr());
+
+  EXPECT_EQ(ReferenceType::get(refType, true), types[9].getPtr());
+  EXPECT_EQ(MaybeType::get(ctxt->i64Type), types[6].getPtr());
+  EXPECT_EQ(LValueType::get(ctxt->i32Type), types[3].getPtr());
+}
+
 TEST_F(TypeTest, TupleType) {
   Type i32 = ctxt->i32Type;
   Type emptyTuple = TupleType::getEmpty(*ctxt);
@@ -348,6 +369,38 @@ TEST_F(TypeTest, printingTest_typeVariables) {
   EXPECT_EQ(floatTyVar->getString(tpo), "_");
 }
 
+TEST_F(TypeTest, typeVariableEquivalenceClasses) {
+  // Create a long chain of type variables: $T0 -> $T1 -> ... -> $T63
+  SmallVector<TypeVariableType *, 64> tvs;
+  for (unsigned k = 0; k < 64; ++k)
+    tvs.push_back(TypeVariableType::createGeneralTypeVariable(*env, k));
+  for (unsigned k = 0; k < 63; ++k)
+    env->bind(tvs[k], tvs[k + 1]);
+
+  // Every type variable should have the last one as representative.
+  for (TypeVariableType *tv : tvs)
+    EXPECT_EQ(env->getRepresentative(tv), tvs.back());
+  EXPECT_NE(env->getRank(tvs.back()), 0u);
+  // The binding of a type variable doesn't change.
+  EXPECT_EQ(env->getBinding(tvs[0]).getPtr(), tvs[1]);
+
+  // Binding the representative to something in its own class would create a
+  // cycle.
+  EXPECT_FALSE(env->canBind(tvs.back(), tvs.front()));
+  EXPECT_FALSE(env->canBind(tvs.back(), tvs[32]));
+
+  // Once the representative is bound, every type variable of the class
+  // simplifies to its binding.
+  bool hadUnboundTypeVar = false;
+  env->simplify(tvs.front(), &hadUnboundTypeVar);
+  EXPECT_TRUE(hadUnboundTypeVar);
+  env->bind(tvs.back(), ctxt->i32Type);
+  for (TypeVariableType *tv : tvs)
+    EXPECT_EQ(env->simplify(tv).getPtr(), ctxt->i32Type.getPtr());
+  EXPECT_EQ(env->simplify(MaybeType::get(tvs.front()))->getString(),
+            "maybe i32");
+}
+
 TEST_F(TypeTest, rebuildType) {
   // Create a fairly complex type, and swap all i8 in it for u8s and make all
   // references immutable.
@@ -380,4 +433,34 @@ TEST_F(TypeTest, rebuildType) {
 
   ASSERT_EQ(rebuilt->getString(TypePrintOptions::forDebug()),
             "@lvalue (u8, &u8, &&u8, &&&u8, void) -> (u8, &u8, void)");
+}
+
+TEST_F(TypeTest, rebuildTypeMemoization) {
+  // (&i32, &i32, &i32) -> (&i32, &i32): the reference type appears 5 times in
+  // the tree, but the rebuilder should only be called once for it.
+  Type tuple = TupleType::get(*ctxt, {refType, refType});
+  Type fn = FunctionType::get({refType, refType, refType}, tuple);
+
+  unsigned numRefCalls = 0;
+  Type rebuilt = fn->rebuildType([&](Type type) -> Type {
+    if (type->is<ReferenceType>()) {
+      ++numRefCalls;
+      return ctxt->i64Type;
+    }
+    return nullptr;
+  });
+  EXPECT_EQ(numRefCalls, 1u);
+  EXPECT_EQ(rebuilt->getString(), "(i64, i64, i64) -> (i64, i64)");
+
+  // When filtering by a property that the type doesn't have, the rebuilder
+  // should never be called.
+  unsigned numCalls = 0;
+  rebuilt = fn->rebuildType(
+      [&](Type type) -> Type {
+        ++numCalls;
+        return nullptr;
+      },
+      TypeProperties::hasTypeVariable);
+  EXPECT_EQ(numCalls, 0u);
+  EXPECT_EQ(rebuilt.getPtr(), fn.getPtr());
 }
\ No newline at end of file
@@ -7,9 +7,12 @@
 
 #include "Sora/Common/SourceLoc.hpp"
 #include "Sora/Common/SourceManager.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 #include <string>
+#include <vector>
 
 using namespace sora;
 
@@ -59,7 +62,9 @@ TEST(SourceLocTest, print) {
 
 /// Test for operator== and operator!= for SourceLoc
 TEST(SourceLocTest, compare) {
+  SourceManager srcMgr;
   const char *str = "ab";
+  srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
 
   auto a = SourceLoc::fromPointer(str);
   auto b = SourceLoc::fromPointer(str + 1);
@@ -74,6 +79,57 @@ TEST(SourceLocTest, compare) {
   EXPECT_TRUE(a >= a);
 }
 
+/// Checks that SourceLocs can be converted to pointers and back, and that
+/// buffers are given distinct ranges of SourceLocs.
+TEST(SourceLocTest, pointers) {
+  static_assert(sizeof(SourceLoc) == 4, "SourceLoc should be 32 bits");
+
+  // Copy the strings, so each buffer has its own memory.
+  SourceManager srcMgr;
+  std::vector<BufferID> buffers;
+  for (StringRef str : {"abc", "", "de\nf"})
+    buffers.push_back(
+        srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBufferCopy(str)));
+
+  SourceLoc prev;
+  for (BufferID buffer : buffers) {
+    StringRef str = srcMgr.getBufferStr(buffer);
+    // Check every character, including the null terminator.
+    for (const char *cur = str.begin(); cur <= str.end(); ++cur) {
+      SourceLoc loc = SourceLoc::fromPointer(cur);
+      ASSERT_TRUE(loc.isValid());
+      EXPECT_EQ(loc.getPointer(), cur);
+      if (prev)
+        EXPECT_TRUE(prev < loc);
+      prev = loc;
+    }
+  }
+
+  EXPECT_EQ(SourceLoc::fromPointer(nullptr), SourceLoc());
+  EXPECT_EQ(SourceLoc().getPointer(), nullptr);
+}
+
+/// Checks that the SourceLocs of the buffers of a destroyed SourceManager are
+/// reused.
+TEST(SourceLocTest, reuse) {
+  SourceLoc first;
+  {
+    SourceManager srcMgr;
+    BufferID buffer =
+        srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBufferCopy("abc"));
+    first = SourceLoc::fromPointer(srcMgr.getBufferStr(buffer).data());
+    ASSERT_TRUE(first.isValid());
+  }
+
+  SourceManager srcMgr;
+  BufferID buffer =
+      srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBufferCopy("defg"));
+  const char *begin = srcMgr.getBufferStr(buffer).data();
+  SourceLoc loc = SourceLoc::fromPointer(begin);
+  EXPECT_EQ(loc, first);
+  EXPECT_EQ(loc.getPointer(), begin);
+}
+
 /// Test that a default-constructed SourceRange is considered invalid.
 TEST(SourceRangeTest, isValid) {
   EXPECT_TRUE(SourceRange().isInvalid());
@@ -99,7 +155,9 @@ TEST(SourceRangeTest, print) {
 
 /// Test for operator== and operator!= for SourceRange
 TEST(SourceRangeTest, compare) {
+  SourceManager srcMgr;
   const char *str = "ab";
+  srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
 
   auto aRange = SourceRange(SourceLoc::fromPointer(str));
   auto bRange = SourceRange(SourceLoc::fromPointer(str + 1));
@@ -121,7 +179,9 @@ TEST(CharSourceRangeTest, emptyAndInvalid) {
 
 /// Test for operator== and operator!= for CharSourceRange
 TEST(CharSourceRangeTest, compare) {
+  SourceManager srcMgr;
   const char *str = "ab";
+  srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
 
   auto aRange = CharSourceRange::fromPointers(str, str + 1);
   auto bRange = CharSourceRange::fromPointers(str + 1, str + 2);
@@ -135,7 +195,9 @@ TEST(CharSourceRangeTest, compare) {
 
 /// Test for CharSourceRange::str
 TEST(CharSourceRangeTest, str) {
+  SourceManager srcMgr;
   const char *str = "ab";
+  srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
 
   auto aRange = CharSourceRange::fromPointers(str, str + 1);
   auto bRange = CharSourceRange::fromPointers(str + 1, str + 2);
@@ -160,4 +222,108 @@ TEST(CharSourceRange, print) {
   output.clear();
   range.print(rso, srcMgr, true, true);
   EXPECT_EQ(rso.str(), "[X:1:1, line:1:14)=\"Hello, World!\"");
-}
\ No newline at end of file
+}
+
+/// Checks that the SourceManager finds the same buffers, lines and columns as
+/// llvm::SourceMgr.
+TEST(SourceManagerTest, getLineAndColumn) {
+  SourceManager srcMgr;
+
+  // Copy the strings, so each buffer has its own memory.
+  std::vector<BufferID> buffers;
+  for (StringRef str : {"", "a", "\n", "a\nbc\n\ndef", "\n\nx\n"})
+    buffers.push_back(
+        srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBufferCopy(str)));
+
+  for (BufferID id : buffers) {
+    StringRef str = srcMgr.getBufferStr(id);
+    // Check every character, including the null terminator.
+    for (const char *cur = str.begin(); cur <= str.end(); ++cur) {
+      SourceLoc loc = SourceLoc::fromPointer(cur);
+      BufferID buffer = srcMgr.findBufferContainingLoc(loc);
+      EXPECT_EQ(buffer, id);
+      EXPECT_EQ(buffer.getRawValue(),
+                srcMgr.llvmSourceMgr.FindBufferContainingLoc(loc.getSMLoc()));
+      auto expected =
+          srcMgr.llvmSourceMgr.getLineAndColumn(loc.getSMLoc(), 0);
+      EXPECT_EQ(srcMgr.getLineAndColumn(loc), expected);
+      EXPECT_EQ(srcMgr.getLineAndColumn(loc, buffer), expected);
+      EXPECT_EQ(srcMgr.findLineNumber(loc), expected.first);
+    }
+  }
+}
+
+/// Checks that buffers are still found once the end of the address space has
+/// been reached, and their SourceLocs are no longer sorted by BufferID.
+TEST(SourceManagerTest, wrappedAllocation) {
+  SourceManager srcMgr;
+  std::vector<BufferID> buffers;
+  buffers.push_back(
+      srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBufferCopy("a\nb")));
+  {
+    // Leave a gap between the buffers of srcMgr.
+    SourceManager other;
+    other.giveBuffer(llvm::MemoryBuffer::getMemBufferCopy("0123456789"));
+    buffers.push_back(
+        srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBufferCopy("cd\n\ne")));
+  }
+  // Leave no room after the last buffer, so the next one goes in a gap.
+  SourceLoc lastLoc = srcMgr.getBufferCharSourceRange(buffers.back()).getEnd();
+  SourceManager::setSourceLocLimitForTesting(lastLoc.getRawValue() + 1);
+  buffers.push_back(
+      srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBufferCopy("f\ngh")));
+  SourceManager::setSourceLocLimitForTesting(0);
+
+  EXPECT_TRUE(srcMgr.getBufferCharSourceRange(buffers[2]).getBegin() <
+              srcMgr.getBufferCharSourceRange(buffers[1]).getBegin());
+
+  for (BufferID buffer : buffers) {
+    StringRef str = srcMgr.getBufferStr(buffer);
+    // Check every character, including the null terminator.
+    for (const char *cur = str.begin(); cur <= str.end(); ++cur) {
+      SourceLoc loc = SourceLoc::fromPointer(cur);
+      ASSERT_TRUE(loc.isValid());
+      EXPECT_EQ(srcMgr.findBufferContainingLoc(loc), buffer);
+      EXPECT_EQ(srcMgr.getLineAndColumn(loc),
+                srcMgr.llvmSourceMgr.getLineAndColumn(loc.getSMLoc(),
+                                                      buffer.getRawValue()));
+    }
+  }
+}
+
+/// Checks that files are mapped when they're large enough and when there's room
+/// for the null terminator, and that they're copied otherwise.
+TEST(SourceManagerTest, loadFile) {
+  SourceManager srcMgr;
+  unsigned pageSize = llvm::sys::Process::getPageSizeEstimate();
+
+  // Creates a temporary file containing \p size 'a' characters, loads it
+  // using \p mmapThreshold and returns the kind of the resulting buffer.
+  auto load = [&](size_t size, uint64_t mmapThreshold) {
+    llvm::SmallString<128> path;
+    int fd;
+    EXPECT_FALSE(
+        llvm::sys::fs::createTemporaryFile("sora-test", "sora", fd, path));
+    {
+      llvm::raw_fd_ostream out(fd, /*shouldClose*/ true);
+      out << std::string(size, 'a');
+    }
+    BufferID buffer = srcMgr.loadFile(path, mmapThreshold);
+    llvm::sys::fs::remove(path);
+    EXPECT_FALSE(buffer.isNull());
+    StringRef str = srcMgr.getBufferStr(buffer);
+    EXPECT_EQ(str.size(), size);
+    EXPECT_EQ(str, std::string(size, 'a'));
+    EXPECT_EQ(*str.end(), 0);
+    return srcMgr.llvmSourceMgr.getMemoryBuffer(buffer.getRawValue())
+        ->getBufferKind();
+  };
+
+  EXPECT_EQ(load(10, 100), llvm::MemoryBuffer::MemoryBuffer_Malloc);
+  EXPECT_EQ(load(100, 100), llvm::MemoryBuffer::MemoryBuffer_MMap);
+  EXPECT_EQ(load(pageSize + 1, 0), llvm::MemoryBuffer::MemoryBuffer_MMap);
+  EXPECT_EQ(load(pageSize, 0), llvm::MemoryBuffer::MemoryBuffer_Malloc);
+  EXPECT_EQ(load(0, 0), llvm::MemoryBuffer::MemoryBuffer_Malloc);
+
+  EXPECT_TRUE(srcMgr.loadFile("this/file/does/not/exist.sora").isNull());
+}
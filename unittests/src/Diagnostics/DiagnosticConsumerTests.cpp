@@ -24,9 +24,9 @@ TEST(PrintingDiagnosticConsumerTest, handle) {
   SourceManager srcMgr;
   srcMgr.giveBuffer(std::move(buff));
 
-  SourceLoc loc(llvm::SMLoc::getFromPointer(str.data() + 4));
-  SourceLoc beg(llvm::SMLoc::getFromPointer(str.data() + 5));
-  SourceLoc end(llvm::SMLoc::getFromPointer(str.data() + 7));
+  SourceLoc loc = SourceLoc::fromPointer(str.data() + 4);
+  SourceLoc beg = SourceLoc::fromPointer(str.data() + 5);
+  SourceLoc end = SourceLoc::fromPointer(str.data() + 7);
 
   CharSourceRange additionalRange(beg, 3);
   CharSourceRange wordRange(loc, 4);
@@ -60,4 +60,40 @@ TEST(PrintingDiagnosticConsumerTest, handleSimple) {
   PrintingDiagnosticConsumer pdc(stream);
   pdc.handle(srcMgr, diag);
   EXPECT_EQ(stream.str(), "error: I'm not lazy!\n");
-}
\ No newline at end of file
+}
+
+TEST(BufferingDiagnosticConsumerTest, flush) {
+  StringRef str = "The Lazy Brown Fox Jumps Over The Lazy Dog";
+
+  auto buff = llvm::MemoryBuffer::getMemBuffer(str, "some_file.sora");
+  str = buff->getBuffer();
+  SourceManager srcMgr;
+  srcMgr.giveBuffer(std::move(buff));
+
+  SourceLoc loc = SourceLoc::fromPointer(str.data() + 4);
+  CharSourceRange wordRange(loc, 4);
+  FixIt fixit("Hyperactive", wordRange);
+
+  BufferingDiagnosticConsumer bdc;
+  {
+    // Use temporary strings to check that the consumer owns its data.
+    std::string first = "I'm not lazy!";
+    std::string second = "Really!";
+    bdc.handle(srcMgr, Diagnostic(first, DiagnosticKind::Error, loc,
+                                  wordRange, fixit));
+    bdc.handle(srcMgr, Diagnostic(second, DiagnosticKind::Error, {}));
+  }
+  EXPECT_EQ(bdc.size(), 2u);
+
+  std::string output;
+  llvm::raw_string_ostream stream(output);
+  PrintingDiagnosticConsumer pdc(stream);
+  bdc.flush([&](const Diagnostic &diag) { pdc.handle(srcMgr, diag); });
+
+  EXPECT_TRUE(bdc.empty());
+  EXPECT_EQ(stream.str(), "some_file.sora:1:5: error: I'm not lazy!\n"
+                          "The Lazy Brown Fox Jumps Over The Lazy Dog\n"
+                          "    ^~~~\n"
+                          "    Hyperactive\n"
+                          "error: Really!\n");
+}
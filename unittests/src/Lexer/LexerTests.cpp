@@ -125,6 +125,44 @@ TEST_F(LexerTest, keywordCommentsAndIdentifiers) {
   CHECK_EOF();
 }
 
+TEST_F(LexerTest, keywordLikeIdentifiers) {
+  const char *input = "a i iff fun funcs Func __ _a while_ continued";
+  Lexer &lexer = getLexer(input);
+  CHECK_NEXT(TokenKind::Identifier, "a", true);
+  CHECK_NEXT(TokenKind::Identifier, "i", false);
+  CHECK_NEXT(TokenKind::Identifier, "iff", false);
+  CHECK_NEXT(TokenKind::Identifier, "fun", false);
+  CHECK_NEXT(TokenKind::Identifier, "funcs", false);
+  CHECK_NEXT(TokenKind::Identifier, "Func", false);
+  CHECK_NEXT(TokenKind::Identifier, "__", false);
+  CHECK_NEXT(TokenKind::Identifier, "_a", false);
+  CHECK_NEXT(TokenKind::Identifier, "while_", false);
+  CHECK_NEXT(TokenKind::Identifier, "continued", false);
+  CHECK_EOF();
+}
+
+// Checks that trivia and comments longer than the lexer's scanning width are
+// correctly skipped.
+TEST_F(LexerTest, longTriviaAndComments) {
+  const char *input = "a                                  b\n"
+                      "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t   \n  c\n"
+                      "// a long line comment that spans more than 32 bytes\n"
+                      "d /* a long block comment that spans more than 32 "
+                      "bytes, and contains some * and / characters */ e\n"
+                      "/* a long block comment that spans more than 32 bytes \n"
+                      "   over multiple lines **/ f /*********************/ g "
+                      "/* an unterminated block comment ...................";
+  Lexer &lexer = getLexer(input);
+  CHECK_NEXT(TokenKind::Identifier, "a", true);
+  CHECK_NEXT(TokenKind::Identifier, "b", false);
+  CHECK_NEXT(TokenKind::Identifier, "c", true);
+  CHECK_NEXT(TokenKind::Identifier, "d", true);
+  CHECK_NEXT(TokenKind::Identifier, "e", false);
+  CHECK_NEXT(TokenKind::Identifier, "f", true);
+  CHECK_NEXT(TokenKind::Identifier, "g", false);
+  CHECK_EOF();
+}
+
 TEST_F(LexerTest, unknownTokens) {
   const char *input = u8"ê€";
 
@@ -5,6 +5,7 @@
 // Copyright (c) 2019 Pierre van Houtryve
 //===----------------------------------------------------------------------===//
 
+#include "Sora/Common/SourceManager.hpp"
 #include "Sora/Lexer/Token.hpp"
 #include "llvm/Support/raw_ostream.h"
 
@@ -44,7 +45,9 @@ TEST(TokenTest, startOfLine) {
 }
 
 TEST(TokenTest, str) {
+  SourceManager srcMgr;
   const char *str = "Hello World";
+  srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
   Token a(TokenKind::Amp, CharSourceRange::fromPointers(str, str + 5), false);
   Token b(TokenKind::LetKw, CharSourceRange::fromPointers(str + 6, str + 11),
           true);
@@ -53,7 +56,9 @@ TEST(TokenTest, str) {
 }
 
 TEST(TokenTest, dump) {
+  SourceManager srcMgr;
   const char *str = "Hello World";
+  srcMgr.giveBuffer(llvm::MemoryBuffer::getMemBuffer(str));
   Token a(TokenKind::Amp, CharSourceRange::fromPointers(str, str + 5), false);
   Token b(TokenKind::LetKw, CharSourceRange::fromPointers(str + 6, str + 11),
           true);